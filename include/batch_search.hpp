@@ -0,0 +1,133 @@
+#ifndef BATCH_SEARCH_HPP
+#define BATCH_SEARCH_HPP
+
+// バッチ評価 MCTS の内部実装（RunMCTSBatch と SelfPlayPool が共有）。公開 API ではない。
+
+#include "board.hpp"
+#include "mcts.hpp"
+#include "mcts_detail.hpp"
+#include "move.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace mcts_detail {
+    enum WorkerState {
+        RUN,
+        NEED_EVAL,  // リーフ到達。同一局面で Prior+Value 取得 → バックプロパ → 展開 → 1手進める
+        IN_FLIGHT,  // 評価待ちのバッチに積まれている
+        COLLIDED    // 衝突数が max_collisions に達したため、次の Integrate まで待機
+    };
+
+    struct Worker {
+        Board board;
+        MCTSNode* node;
+        WorkerState state = RUN;
+        std::vector<Move> moves;
+        int depth = 0;  // node のルートからの深さ
+    };
+
+    /// batch_array_fn に渡す連結済みバッファ。EvalBatch が持ち、バッチを使い回す間は確保し直さない
+    struct ArrayBuffers {
+        std::vector<float> planes;
+        std::vector<int32_t> moveIndices;
+        std::vector<int32_t> moveOffsets;
+        std::vector<float> priors;
+        std::vector<float> values;
+    };
+
+    /// 1 回のバッチ評価分のリーフ（1 本の木ぶん）。
+    /// std::map だと辞書順になり、バッチ推論の戻り値インデックスと直感がズレる。
+    /// ワーカー走査順で初出の FEN だけ列挙し、Python 側のリスト順と厳密に対応させる。
+    /// キャッシュにヒットした局面は fens に載せず、Gather の時点で prior/value を確定させる。
+    struct EvalBatch {
+        using EvalEntry = std::pair<std::size_t, std::pair<MCTSNode*, std::vector<Move>>>;
+        std::vector<std::string> fens;
+        std::vector<std::vector<std::string>> uci;    // batch_array_fn のときは作らない
+        std::vector<float> planes;                    // batch_array_fn 用: fens と同順に INPUT_SIZE ずつ
+        std::vector<std::vector<int32_t>> moveIndices;  // batch_array_fn 用: fens と同順の合法手の policy 添字
+        std::vector<std::vector<EvalEntry>> entries;  // 局面ごと（キャッシュヒット分を含む）
+        std::vector<long> entryToFen;                 // entries -> fens の添字。ヒットは -1
+        std::vector<U64> hashes;
+        std::vector<double> toMove;                   // 局面の手番がルートと同じなら 1、違えば -1（キャッシュの値の向き）
+        std::vector<std::vector<double>> priors;      // 正規化済み prior
+        std::vector<double> values;
+        std::unordered_map<std::string, std::size_t> fenToEntry;
+        double evalMs = 0.0;                          // collect_stats 用: 入力の準備と評価器の時間
+        /// batch_array_fn の呼び出し用。複数のバッチをまとめて評価するときは先頭のバッチのものを使う
+        ArrayBuffers arrays;
+
+        /// 次の Gather に使えるよう中身を空にする（確保済みの容量は残す）
+        void Clear();
+    };
+
+    /// 評価器を呼んで batch.priors / values を埋める。木には触れないので別スレッドから呼んでよい。
+    void evaluateBatch(EvalBatch& batch, const MCTSOptions& options);
+    /// 複数の木のバッチを 1 回の評価器呼び出しにまとめる（木をまたいで同一 FEN は 1 回だけ渡す）
+    void evaluateBatches(const std::vector<EvalBatch*>& batches, const MCTSOptions& options);
+
+    /// バッチ評価用の 1 本の探索木とワーカー群。仮想損失で並列ワーカーを別々のリーフに散らす。
+    class BatchSearch {
+    public:
+        BatchSearch(const Board& rootBoard, int numWorkers, std::mt19937& gen, const MCTSOptions& options);
+        ~BatchSearch();
+        BatchSearch(const BatchSearch&) = delete;
+        BatchSearch& operator=(const BatchSearch&) = delete;
+
+        MCTSNode* Root() const { return root_; }
+        const Board& RootBoard() const { return rootBoard_; }
+        int Completed() const { return completed_; }
+        /// MCTS-solver がルートの結果を確定させたか
+        bool Solved() const { return options_.solver && root_->proven != GameResult::Ongoing; }
+        long NodeCount() const { return nodeCount_; }
+        std::size_t NumWorkers() const { return workers_.size(); }
+        std::size_t CountState(WorkerState s) const;
+        long Collisions() const { return totalCollisions_; }
+
+        /// 保存した探索結果でルートを埋める（MCTSOptions::book）。最初の Advance の前に呼ぶ
+        void Seed(const MCTSResult& seed) { nodeCount_ += seedRoot(root_, seed); }
+        /// この探索で行うシミュレーション数。Completed() はこれを超えない（0 なら無制限）。
+        /// Gumbel のルート探索（MCTSOptions::gumbel）の逐次半減の配分にも使う
+        void SetBudget(int simulations) { budget_ = simulations; }
+        /// RUN のワーカーを 1 手ずつ進める。リーフ到達で NEED_EVAL、終局ならその場でバックアップしてルートへ戻す
+        /// （SetBudget の数を使い切っていれば数えずに戻す）。
+        /// 評価待ちのリーフに到達したら衝突として仮想訪問を残したままルートへ戻す（上限超過で COLLIDED）
+        void Advance();
+        /// NEED_EVAL のワーカーを最大 maxWorkers 件 batch に積んで IN_FLIGHT にする。積んだ数を返す
+        std::size_t Gather(EvalBatch& batch, std::size_t maxWorkers);
+        /// 評価結果で展開・バックアップし、各ワーカーを 1 手進める。remaining を超えた分は仮想損失を戻してルートへ戻す。
+        /// 衝突で残した仮想訪問もここで取り消し、COLLIDED のワーカーを再開させる。batch.evalMs は統計に足す
+        void Integrate(EvalBatch& batch, int remaining);
+        /// 結果（stats を含む。停止理由と経過時間は呼び出し側が埋める）
+        MCTSResult Result() const;
+        /// 木が memory_limit_bytes を超えていれば、評価待ちでないワーカーをルートへ戻してから訪問の少ない部分木を刈る
+        void EnforceMemoryLimit();
+
+    private:
+        void backup(MCTSNode* leaf, double value);
+        void resetWorker(Worker& w);
+        void backupProven(Worker& w);
+        void releaseCollisions();
+        void descend(Worker& w);
+
+        Board rootBoard_;
+        std::mt19937& gen_;
+        const MCTSOptions& options_;
+        bool rootWhite_;
+        MCTSNode* root_;
+        std::vector<Worker> workers_;
+        int completed_ = 0;
+        long nodeCount_ = 1;
+        std::vector<MCTSNode*> collisionLeaves_;  // 仮想訪問を残したままの衝突経路の末端
+        long totalCollisions_ = 0;
+        StatsRecorder stats_;
+        int budget_ = 0;
+        GumbelRoot gumbel_;
+    };
+}
+
+#endif
@@ -0,0 +1,63 @@
+#ifndef BITBASE_HPP
+#define BITBASE_HPP
+
+#include "board.hpp"
+#include "move.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+/// ビットベースファイルの形式（リトルエンディアン）
+///   ヘッダ: "BCBB" + uint32 バージョン + 駒構成 8 バイト（"KRK" などを NUL で埋める）
+///   本体: 2 × 64^n 局面ぶんの 2 ビット値。局面 i は i/4 バイト目の (i%4)*2 ビット目から。
+///         0=引き分け（または現れない配置）, 1=手番の勝ち, 2=手番の負け
+/// 局面の添字 = ((手番 * 64 + 駒 0 のマス) * 64 + 駒 1 のマス) ...。手番は 0=白。駒は駒構成の文字順に並べ、
+/// 駒構成の前半（強い側）を白とする。同じ駒が複数あればマスの昇順
+const char BITBASE_MAGIC[4] = {'B', 'C', 'B', 'B'};
+const uint32_t BITBASE_VERSION = 1;
+const std::size_t BITBASE_HEADER_SIZE = 16;
+const int BITBASE_MAX_PIECES = 4;
+
+/// キングを含めて 4 駒までの終盤の勝ち・引き分け・負けの表（ビットベース）。MoveGen の利き表を使った後退解析で作り、
+/// ファイルに書いて mmap で読める。50 手ルールと千日手は考えない（理論上の結果）。
+/// 生成・読み込みは 1 スレッドから呼び（生成の初期化は内部でスレッドプールに分ける）、その後の Probe は複数スレッドから同時に呼んでよい
+class Bitbases {
+public:
+    Bitbases();
+    ~Bitbases();
+    Bitbases(const Bitbases&) = delete;
+    Bitbases& operator=(const Bitbases&) = delete;
+
+    /// material（"KRK" "KPK" "KQKR" "KBNK" のように一方のキングと駒、もう一方のキングと駒）の表を作る。
+    /// 駒を取る手・昇格で移る先の表がなければ先に作る。既にあれば何もしない。不正な駒構成は std::invalid_argument
+    void Generate(const std::string& material);
+    /// directory/<駒構成>.bb があれば読み、なければ生成して書く（移る先の表も同じ）
+    void LoadOrGenerate(const std::string& material, const std::string& directory);
+    /// 生成・読み込み済みの表をファイルに書く
+    void Save(const std::string& material, const std::string& path) const;
+    /// ファイルを mmap して表に加える。形式が違えば std::runtime_error
+    void Load(const std::string& path);
+
+    /// board の駒構成の表があれば結果（白勝ち・黒勝ち・引き分け）を返す。なければ Ongoing。
+    /// キングだけなら引き分け。キャスリング権のある局面・アンパッサンで取れる局面は引かない
+    GameResult Probe(const Board& board) const;
+    /// 持っている表の駒構成（正規化した名前）
+    std::vector<std::string> Materials() const;
+    /// material を正規化した名前（駒を QRBNP 順に並べ、強い側を前にする）。不正なら std::invalid_argument
+    static std::string Canonical(const std::string& material);
+
+private:
+    struct Table;
+
+    const Table* find(const std::string& canonical) const;
+    void add(std::unique_ptr<Table> table);
+    /// 移る先の表が揃っている前提で canonical の表を後退解析で作る
+    void build(const std::string& canonical);
+
+    std::vector<std::unique_ptr<Table>> tables_;
+    int maxPieces_ = 2;
+};
+
+#endif
@@ -36,11 +36,15 @@ class Board {
         uint8_t castlingRights_;  // bit0=白キング側, bit1=白クイーン側, bit2=黒キング側, bit3=黒クイーン側. 1=可能
         int enPassantTarget_;     // アンパッサン可能な「取られるマス」の square index (0-63), なければ -1
         int halfMoveClock_;       // 50手ルール用。キャプチャ/ポーン移動で0に、それ以外で+1
+        int mgScore_;             // 静的評価（白から見た中盤値）。SetPieceAt/ClearPieceAt で差分更新
+        int egScore_;             // 同・終盤値
+        int phase_;               // ゲームフェーズ（Evaluation::PhaseWeight の合計）
         std::vector<BoardUndoState> undoStack_;
 
         void ClearPieceAt(Square sq, int pieceType, bool white);
         void SetPieceAt(Square sq, int pieceType, bool white);
         void ComputeZobristHash();
+        void ComputeEvaluation();
     public:
         Board();
         Board(const Board&) = default;
@@ -48,6 +52,8 @@ class Board {
         void Print() const;
         void Update();
         void SetFromFen(const std::string& fen);
+        /// 駒の配置だけから局面を作る（キャスリング権・アンパッサンなし、50 手カウンタ 0）。各配列は n 要素
+        void SetPieces(const int* pieceTypes, const Square* squares, const bool* white, int n, bool whiteToMove);
         std::string GetFen() const;
         void MakeMove(const Move& move);
         void UnmakeMove(const Move& move);
@@ -58,6 +64,8 @@ class Board {
         U64 GetAllPieces() const;
         U64 GetWhitePieces() const;
         U64 GetBlackPieces() const;
+        /// 指定した色・駒種のビットボード
+        U64 GetPieceBitboard(int pieceType, bool white) const;
         bool GetWhiteToMove() const { return whiteToMove; }
         U64 GetZobristHash() const { return zobristHash; }
         // 特殊ルール用 Getter（現状は初期値のまま。MakeMove/UnmakeMove での更新は後続コミット）
@@ -67,6 +75,9 @@ class Board {
         bool CanBlackQueensideCastle() const { return (castlingRights_ & 8u) != 0; }
         int GetEnPassantTarget() const { return enPassantTarget_; }
         int GetHalfMoveClock() const { return halfMoveClock_; }
+        /// 駒価値＋PST をフェーズで補間した静的評価（白から見たセンチポーン）
+        int GetStaticEval() const;
+        int GetPhase() const { return phase_; }
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,64 @@
+#ifndef BOARD_BATCH_HPP
+#define BOARD_BATCH_HPP
+
+#include "board.hpp"
+#include "move.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class ThreadPool;
+
+/// N 局を C++ 側でまとめて保持し、手の適用・合法手マスク・結果・入力符号化を一括で行うベクトル化環境。
+/// 手は MoveToPolicyIndex の添字で受け取る。各局の合法手は手を指すたびに 1 回だけ生成して使い回す。
+class BoardBatch {
+public:
+    /// fen が空なら初期局面。numThreads>1 なら各操作を局ごとにスレッドプールで分担する
+    BoardBatch(int size, const std::string& fen = "", int numThreads = 1);
+    ~BoardBatch();
+    BoardBatch(const BoardBatch&) = delete;
+    BoardBatch& operator=(const BoardBatch&) = delete;
+
+    std::size_t Size() const { return slots_.size(); }
+    /// 全局を開始局面に戻す
+    void Reset();
+    void Reset(const std::size_t* indices, std::size_t n);
+    /// actions[i] を局 i に指し、results[i] に指した後の結果を書く（nullptr なら書かない）。
+    /// 終局済みの局は actions を無視する。合法手でない添字は例外（どの局にも手を指す前に検査する）
+    void Step(const int32_t* actions, int8_t* results = nullptr);
+    /// out[Size() × POLICY_SIZE] に合法手の位置を 1、それ以外を 0 で書く。終局済みの局は全 0
+    void LegalMask(uint8_t* out) const;
+    /// out[Size()] に結果を書く: 1=白勝ち, -1=黒勝ち, 0=引き分け, 2=進行中
+    void Results(int8_t* out) const;
+    /// out[Size() × INPUT_SIZE] に EncodeBoard の入力平面を書く
+    void Encode(float* out) const;
+
+    const Board& At(std::size_t i) const { return slots_[i].board; }
+    GameResult Result(std::size_t i) const { return slots_[i].result; }
+    int Plies(std::size_t i) const { return slots_[i].plies; }
+
+private:
+    struct Slot {
+        Board board;
+        std::vector<Move> moves;                 // 現局面の合法手（終局済みなら空）
+        std::unordered_map<U64, int> hashCount;  // 千日手検出用
+        GameResult result = GameResult::Ongoing;
+        int plies = 0;
+    };
+
+    void resetSlot(Slot& slot);
+    /// 合法手を生成し直して結果を更新する
+    void refresh(Slot& slot);
+    /// fn(i) を全局に適用する（スレッドプールがあれば分担）
+    template <class Fn>
+    void forEach(Fn fn) const;
+
+    std::string startFen_;
+    std::vector<Slot> slots_;
+    std::unique_ptr<ThreadPool> pool_;
+};
+
+#endif
@@ -0,0 +1,32 @@
+#ifndef CPU_FEATURES_HPP
+#define CPU_FEATURES_HPP
+
+// 実行時の CPU 機能判定と、命令セット別にコンパイルする関数の属性。
+// ビルドは -march なしで行い（Python 拡張を古い CPU でも動かすため）、速くなる命令は実行時に選ぶ。
+
+/// 実行中の CPU が持つ拡張命令（x86-64 以外では全て false）
+struct CpuFeatures {
+    bool popcnt = false;
+    bool bmi2 = false;
+    bool avx2 = false;
+    /// BMI2 の PEXT が速い（数サイクル）。AMD の Zen2 以前（ファミリ 19h 未満）は PEXT をマイクロコードで実行し、
+    /// 占有ビットの数に比例して遅くなるので、BMI2 があっても false
+    bool fastPext = false;
+};
+
+/// 初回呼び出しで判定して以後は同じ値を返す。環境変数 CHESS_ENGINE_ISA=generic なら全て false として扱う
+/// （CHESS_CLONES_* の関数は動的リンク時に選ばれるので、この指定の影響を受けない）
+const CpuFeatures& GetCpuFeatures();
+
+// 関数を拡張命令あり・なしの 2 通りにコンパイルし、読み込み時（Python 拡張なら import 時）に CPU に合う方を選ぶ。
+// GCC / Clang の target_clones（ifunc）を使うので x86-64 の ELF のみ。それ以外では何もしない
+#if defined(__x86_64__) && defined(__ELF__) && defined(__has_attribute)
+#if __has_attribute(target_clones)
+#define CHESS_CLONES_POPCNT __attribute__((target_clones("popcnt", "default")))
+#endif
+#endif
+#ifndef CHESS_CLONES_POPCNT
+#define CHESS_CLONES_POPCNT
+#endif
+
+#endif
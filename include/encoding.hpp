@@ -0,0 +1,17 @@
+#ifndef ENCODING_HPP
+#define ENCODING_HPP
+
+#include "board.hpp"
+#include "training_data.hpp"
+
+/// ニューラルネット入力の平面数（各 64 要素、a1=0 … h8=63 の絶対座標）
+///   0-5: 白 P N B R Q K, 6-11: 黒 p n b r q k, 12: 白番なら全 1,
+///   13-16: キャスリング権 K Q k q（全 1/全 0）, 17: アンパッサン可能マス, 18: halfMoveClock/100
+const int INPUT_PLANES = 19;
+const int INPUT_SIZE = INPUT_PLANES * 64;
+
+/// out[INPUT_SIZE] に書き込む（0 初期化も行う）
+void EncodeBoard(const Board& board, float* out);
+void EncodePackedPosition(const PackedPosition& pos, float* out);
+
+#endif
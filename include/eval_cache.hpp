@@ -0,0 +1,68 @@
+#ifndef EVAL_CACHE_HPP
+#define EVAL_CACHE_HPP
+
+#include "bitboard.hpp"
+#include "move.hpp"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+/// 評価器（prior/value コールバック）の結果を Zobrist ハッシュで引くキャッシュ。
+/// 容量固定・シャード分割（シャードごとに mutex）で、複数スレッド・複数の RunMCTS 呼び出しから共有できる。
+/// 評価器は局面だけの関数である前提（同じ局面なら同じ prior/value を返す）。
+/// value は key の局面の手番から見た向きで持つ。ルート手番から見た値を返す評価器では、呼び出し側が向きを直して渡す・受け取る
+/// （手番の違うルートの探索で 1 つのキャッシュを共有しても符号が合う）。
+class EvalCache {
+public:
+    struct Stats {
+        uint64_t lookups;
+        uint64_t hits;
+        uint64_t inserts;
+        uint64_t evictions;  // 別局面のエントリを上書きした回数
+        std::size_t capacity;
+        std::size_t size;    // 使用中スロット数
+    };
+
+    /// capacity: 全体のエントリ数。numShards は 2 の冪に切り上げる
+    explicit EvalCache(std::size_t capacity = 1u << 18, std::size_t numShards = 64);
+
+    /// ヒット時は priors（moves の順、正規化済み）と value（手番から見た値）を書き込んで true。
+    /// 合法手の列（数と各手の from/to/昇格）が moves と一致しないエントリはハッシュ衝突とみなしミス扱い。
+    bool Lookup(U64 key, const std::vector<Move>& moves, std::vector<double>& priors, double& value);
+    /// priors は moves の順、value は key の局面の手番から見た値
+    void Insert(U64 key, const std::vector<Move>& moves, const std::vector<double>& priors, double value);
+    void Clear();
+    Stats GetStats() const;
+    void ResetStats();
+
+private:
+    struct Entry {
+        U64 key = 0;
+        U64 movesKey = 0;  // 合法手の列のハッシュ（衝突の検出と priors の並びの確認）
+        bool used = false;
+        float value = 0.0f;
+        std::vector<float> priors;
+    };
+    struct Shard {
+        std::mutex mutex;
+        std::vector<Entry> entries;
+    };
+
+    Shard& ShardFor(U64 key) { return shards_[key & shardMask_]; }
+    std::size_t SlotFor(U64 key) const { return static_cast<std::size_t>((key >> shardBits_) % entriesPerShard_); }
+
+    std::unique_ptr<Shard[]> shards_;
+    std::size_t numShards_;
+    std::size_t shardMask_;
+    int shardBits_;
+    std::size_t entriesPerShard_;
+    std::atomic<uint64_t> lookups_{0};
+    std::atomic<uint64_t> hits_{0};
+    std::atomic<uint64_t> inserts_{0};
+    std::atomic<uint64_t> evictions_{0};
+};
+
+#endif
@@ -0,0 +1,21 @@
+#ifndef EVALUATION_HPP
+#define EVALUATION_HPP
+
+#include "bitboard.hpp"
+
+/// 駒の価値＋駒位置テーブル（PST）の静的評価。中盤（mg）と終盤（eg）の値をゲームフェーズで補間する。
+/// Board は駒の配置・除去ごとに Mg / Eg / PhaseWeight を足し引きし、評価値を差分更新する。
+class Evaluation {
+public:
+    /// フェーズ重み（N=B=1, R=2, Q=4）の初期局面での合計。これ以上は中盤として扱う
+    static const int MAX_PHASE = 24;
+
+    /// 駒価値＋PST（センチポーン、白なら正・黒なら負）
+    static int Mg(int pieceType, Square sq, bool isWhite);
+    static int Eg(int pieceType, Square sq, bool isWhite);
+    static int PhaseWeight(int pieceType);
+    /// mg / eg（白から見た値）を phase で補間
+    static int Taper(int mg, int eg, int phase);
+};
+
+#endif
@@ -3,12 +3,21 @@
 
 #include "board.hpp"
 #include "move.hpp"
+#include "playout.hpp"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
 #include <functional>
 #include <random>
 #include <string>
 #include <utility>
 #include <vector>
 
+class Bitbases;
+class EvalCache;
+class OpeningBook;
+class Tracer;
+
 struct MCTSNode {
     Move move_from_parent;
     MCTSNode* parent;
@@ -17,13 +26,73 @@ struct MCTSNode {
     double W;
     double P;  // prior (P(s,a)); 未設定時は一様
     int N_virtual = 0;  // バッチ用: 選択中ワーカー数。UCB で N + N_virtual として使用し、並列ワーカーが同じ子を選ばないようにする
+    bool pending = false;  // バッチ用: 評価待ちのリーフ。別のワーカーが到達したら衝突として扱う
+    /// 確定した結果（白勝ち/黒勝ち/引き分け）。終局ノードは初回到達時に、内部ノードは MCTS-solver が子から設定する。
+    /// 確定済みノードは合法手生成も評価もせず、この値をそのままバックアップする
+    GameResult proven = GameResult::Ongoing;
+    /// 勝ち負けが確定したとき、このノードから終局までの手数（プライ）。勝つ側は最短、負ける側は最長の手順で数える。
+    /// ビットベース・定跡で確定した場合や引き分けは不明として -1
+    int16_t provenPlies = -1;
+};
+
+/// 探索を打ち切った理由
+enum class MCTSStopReason {
+    Iterations,    // iterations を使い切った
+    TimeLimit,     // time_limit_ms に到達
+    NodeLimit,     // node_limit に到達
+    SmartPruning,  // 残り予算では最多訪問手が逆転不能
+    Converged,     // ルートの訪問分布が収束
+    Proven,        // MCTS-solver がルートの結果を確定させた
+    Stopped,       // stop_flag が立てられた
+    Book           // 定跡（MCTSOptions::book）の保存結果をそのまま返した
+};
+
+/// 探索の統計。カウンタは常に数え、フェーズ別時間は MCTSOptions::collect_stats のときだけ測る（時計を読むコストがあるため）。
+/// 深さはルートを 0 とした、シミュレーションが行き着いたノードの深さ
+struct MCTSStats {
+    long nodesCreated = 0;      // 展開で作ったノード数
+    int maxDepth = 0;
+    double avgDepth = 0.0;
+    double selectMs = 0.0;      // 木を下る（PUCT で子を選び手を進める）時間
+    double expandMs = 0.0;      // リーフの合法手生成と子ノードの作成
+    double evalMs = 0.0;        // キャッシュ参照・評価器・プレイアウト。バッチでは入力の準備を含み、パイプライン時は他と重なる
+    double backupMs = 0.0;
+    long evalCalls = 0;         // 評価器の呼び出し回数（逐次はリーフごと、バッチはバッチごと）
+    long evalPositions = 0;     // 評価器に渡した局面数
+    double avgBatchFill = 0.0;  // evalPositions / evalCalls
+    int minBatchFill = 0;
+    long collisions = 0;        // バッチ: 評価待ちのリーフへの再到達
+    long dedupHits = 0;         // バッチ: 同じバッチ内の同一局面を 1 回の評価にまとめた数
+    long cacheHits = 0;         // eval_cache のヒット数
+    long nodesPruned = 0;       // memory_limit_bytes で刈ったノード数
+    long bitbaseHits = 0;       // bitbases で確定させたノード数
+    std::size_t treeBytes = 0;  // 探索終了時の木のメモリ（MCTSTreeBytes）
 };
 
 // RunMCTSの戻り値
 struct MCTSResult {
     std::vector<std::pair<Move, int>> visits;
+    /// visits と同順のルートの子の prior（ルートノイズ適用後）
+    std::vector<double> priors;
     double rootValue;
     int rootVisits;
+    MCTSStopReason stopReason = MCTSStopReason::Iterations;
+    double elapsedMs = 0.0;
+    /// ルート局面の確定結果（未確定なら Ongoing）と、visits と同順の各手の確定結果
+    GameResult provenResult = GameResult::Ongoing;
+    /// provenResult が勝ち負けのとき、ルートから終局までの手数（プライ）。不明なら -1（MCTSNode::provenPlies）
+    int provenPlies = -1;
+    std::vector<GameResult> provenMoves;
+    /// visits と同順の各手の確定結果までの手数（プライ、手を指した後の局面から数える）。不明なら -1
+    std::vector<int> provenMovePlies;
+    /// visits と同順の各手の平均値（子の W/N、MCTSTree::MoveValue と同じ向き）。未訪問なら 0
+    std::vector<double> moveValues;
+    /// Gumbel のルート探索（MCTSOptions::gumbel）が選んだ手の visits の添字。-1 なら未使用（SelectBestMoveIndex は訪問数で選ぶ）
+    int selectedIndex = -1;
+    /// Gumbel のルート探索の改善方策 softmax(log(prior) + σ(q))。visits と同順で、未訪問の手の q は訪問した手の prior 加重平均。
+    /// 訪問数より少ないシミュレーションで方策の学習目標になる。未使用なら空
+    std::vector<double> improvedPolicy;
+    MCTSStats stats;
 };
 
 /// PVNN 等で 1 回の推論で Policy+Value を返すバッチ用の戻り値
@@ -32,6 +101,17 @@ struct BatchEvalResult {
     std::vector<double> values;               // 各 FEN の value [-1, 1]
 };
 
+/// 配列渡しのバッチ評価の入出力。入力は C++ 側が埋めたバッファで、評価器は priors / values をその場で書く。
+/// ポインタは呼び出しの間だけ有効
+struct BatchEvalArrays {
+    std::size_t n = 0;                     // 局面数
+    const float* planes = nullptr;         // n × INPUT_SIZE（encoding.hpp の EncodeBoard）
+    const int32_t* moveIndices = nullptr;  // 全局面の合法手の MoveToPolicyIndex を連結したもの
+    const int32_t* moveOffsets = nullptr;  // n+1 要素。局面 i の手は moveIndices[moveOffsets[i], moveOffsets[i+1])
+    float* priors = nullptr;               // 出力 n × POLICY_SIZE（0 初期化済み）。合法手の位置だけを prior として読む
+    float* values = nullptr;               // 出力 n。batch_eval_fn の values と同じ向き
+};
+
 struct MCTSOptions {
     std::function<std::vector<double>(const Board&, const std::vector<Move>&)> prior_fn;
     std::function<double(const Board&)> value_fn;
@@ -45,8 +125,26 @@ struct MCTSOptions {
         const std::vector<std::vector<std::string>>& uci_list_per_fen)> batch_prior_fn;
     /// バッチモード用: fen_list -> value_list (各要素は [-1,1])
     std::function<std::vector<double>(const std::vector<std::string>& fens)> batch_value_fn;
+    /// バッチモード用（推論 1 回、配列渡し）。FEN・UCI 文字列を作らず、符号化済みの局面を渡す。batch_eval_fn より優先
+    std::function<void(BatchEvalArrays& arrays)> batch_array_fn;
     int batch_size = 32;
+    /// バッチモードで同時に扱うバッチ数。2 以上で評価器を別スレッドで呼び、評価中も次のバッチのリーフ選択を続ける
+    int pipeline_depth = 1;
+    /// バッチモードで 1 回のリーフ収集中に許す衝突（評価待ちのリーフへの再到達）の数。
+    /// 衝突したワーカーは経路の仮想訪問を残したままルートからやり直し、上限を超えたらバッチの評価が終わるまで待機する
+    int max_collisions = 64;
     double c_puct = 1.4142135623730950488;  // sqrt(2)
+    /// Gumbel のルート探索（Gumbel MuZero）。ルートでは PUCT とディリクレノイズの代わりに、log(prior) + Gumbel ノイズの上位
+    /// gumbel_top_k 手（0 以下なら全合法手）を逐次半減で絞り込む。各段は残った手に iterations を均等に配り、
+    /// g + log(prior) + σ(q) の上位半分を残す。最後に残った手を MCTSResult::selectedIndex、改善方策を improvedPolicy に返す。
+    /// ルートより下は PUCT のまま。数十シミュレーションの少ない予算で prior より良い手を選ぶためのもの
+    bool gumbel = false;
+    int gumbel_top_k = 16;
+    /// σ(q) = (gumbel_c_visit + ルートの子の最大訪問数) * gumbel_c_scale * q（q は子の平均値を [0,1] に写したもの）
+    double gumbel_c_visit = 50.0;
+    double gumbel_c_scale = 1.0;
+    /// Gumbel ノイズの大きさ。0 なら prior と値だけで決定的に選ぶ（評価対局向け）
+    double gumbel_scale = 1.0;
     /// ルートの prior に加えるディリクレノイズ。0.0 なら無効
     double dirichlet_alpha = 0.0;
     /// ルートでの混合率: (1-epsilon)*prior + epsilon*dirichlet
@@ -54,12 +152,70 @@ struct MCTSOptions {
     /// PFU: 未訪問ノードの初期値。0 なら無効。>0 のとき未訪問子のスコアに initial_value を加える。
     /// initial_value = clamp(parent_value - delta, -1, 1)。delta = pfu_scale/sqrt(parent_N) で親の訪問回数に応じてペナルティを減衰。
     double pfu_scale = 0.0;
+    /// value_fn もバッチ評価もないときに使うプレイアウトの方針・最大手数
+    PlayoutOptions playout;
+    /// value_fn の代わりに組み込みの静的評価（Board::GetStaticEval、差分更新）を使う。
+    /// 値は tanh(ルート手番から見たセンチポーン / static_eval_scale)。prior_fn とは併用できる
+    bool static_eval = false;
+    double static_eval_scale = 400.0;
+    /// prior_fn の代わりに組み込みの SEE prior（SEEPriors）を使う。prior は exp(SEE / see_prior_scale) に比例し、
+    /// 得する取る手を押し上げ、駒をただで渡す手を下げる。バッチ評価では評価器の prior を使う
+    bool see_prior = false;
+    double see_prior_scale = 200.0;
+    /// 評価結果キャッシュ（所有しない）。nullptr なら無効。value_fn またはバッチ評価を使うときのみ参照し、
+    /// ランダムプレイアウトの値はキャッシュしない。
+    EvalCache* eval_cache = nullptr;
+    /// 探索予算。iterations は常に上限として働き、以下は 0 なら無効。
+    double time_limit_ms = 0.0;  // 経過時間（ミリ秒）の上限
+    int node_limit = 0;          // 木のノード数の上限
+    /// 木のメモリ（MCTSTreeBytes）の上限。0 なら無制限。超えたら探索を止めずに、訪問の少ない展開済みの部分木の子を捨てて
+    /// 上限の 3/4 まで減らす（刈ったノードは N / W を保ったまま未展開に戻り、次に到達したら評価し直して展開する）。
+    /// 判定はシミュレーション（バッチモードではバッチ）の合間なので、その間の展開ぶん上限を超えることがある
+    std::size_t memory_limit_bytes = 0;
+    /// 残り予算（反復数、時間制限があれば探索速度からの推定も含む）で最多訪問手が逆転不能になったら打ち切る。
+    /// 合法手が 1 つしかない場合も即座に打ち切る。
+    bool smart_pruning = false;
+    /// >0: convergence_interval 反復ごとにルート訪問分布の KL ダイバージェンスを測り、この値未満なら打ち切る
+    double convergence_kld = 0.0;
+    int convergence_interval = 100;
+    /// MCTS-solver: 勝ち・負け・引き分けが確定したノードを親へ伝播し、確定負けの子を選ばない。ルートが確定したら打ち切る。
+    /// 訪問分布が変わるので既定は無効（終局ノードの結果を保持して再評価しないのは solver によらない）
+    bool solver = false;
+    /// 別スレッドから探索を止めるためのフラグ（nullptr なら無効）。true になった時点で打ち切る
+    const std::atomic<bool>* stop_flag = nullptr;
+    /// MCTSResult::stats のフェーズ別時間（select / expand / eval / backup）を測る
+    bool collect_stats = false;
+    /// バッチ探索の各段階の区間を記録するトレーサー（所有しない）。nullptr なら無効
+    Tracer* tracer = nullptr;
+    /// 探索結果の定跡（所有しない）。nullptr なら無効。RunMCTS（GetBestMoveMCTS / RunMCTSMany も）はルート局面が載っていれば、
+    /// 保存したルート訪問数が iterations 以上かルートが確定済みならその結果をそのまま返す（stopReason は Book）。
+    /// 足りなければルートと子の訪問数・値・prior を保存結果で埋めた木から探索を続け、合計 iterations 訪問まで足す
+    /// （埋めた子は未展開で、次に到達したら評価して展開する。ルートのディリクレノイズは掛からない）
+    const OpeningBook* book = nullptr;
+    /// 終盤ビットベース（所有しない）。nullptr なら無効。ルート以外のノードを展開するときに引き、載っていれば
+    /// 終局と同じく確定ノードにする（solver が有効なら祖先へ伝播する）。プレイアウトで引くには playout.bitbases も設定する
+    const Bitbases* bitbases = nullptr;
 };
 
+const char* StopReasonToString(MCTSStopReason reason);
+
+/// nodeCount ノードの木が使うメモリ（バイト）。ノード本体と親の children の要素の分で、アロケータの管理領域は含まない
+std::size_t MCTSTreeBytes(long nodeCount);
+
 MCTSResult RunMCTS(const Board& root, int iterations, std::mt19937& gen);
 MCTSResult RunMCTS(const Board& root, int iterations, std::mt19937& gen, const MCTSOptions& options);
 
-/// MCTS で最善手を1手返す（訪問数が最大の手）。合法手がない場合は未使用の Move を返す。
+/// 独立した複数ルートをスレッドプールで並列に探索する。roots[i] は seeds[i] の乱数で探索し、結果は roots と同じ順。
+/// seeds が roots より短ければ足りない分は seeds の末尾（空なら 0）に添字を足した値を使う。numThreads<=0 ならハードウェアスレッド数。
+/// options のコールバックと eval_cache は複数スレッドから同時に呼ばれる
+std::vector<MCTSResult> RunMCTSMany(const std::vector<Board>& roots, int iterations, const std::vector<unsigned int>& seeds,
+                                    const MCTSOptions& options, int numThreads = 0);
+
+/// 探索結果から指す手の visits 内の添字を返す。確定勝ちの手があればそれ（複数なら終局までが最短の手）を、なければ確定負けを除いた最多訪問手
+/// （Gumbel のルート探索では selectedIndex の手）。visits が空なら -1
+int SelectBestMoveIndex(const MCTSResult& result, bool whiteToMove);
+
+/// MCTS で最善手を1手返す（訪問数が最大の手。確定勝ちがあればその手）。合法手がない場合は未使用の Move を返す。
 Move GetBestMoveMCTS(const Board& root, int iterations, std::mt19937& gen);
 Move GetBestMoveMCTS(const Board& root, int iterations, std::mt19937& gen, const MCTSOptions& options);
 
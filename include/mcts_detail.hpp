@@ -0,0 +1,494 @@
+#ifndef MCTS_DETAIL_HPP
+#define MCTS_DETAIL_HPP
+
+// MCTS 実装（mcts.cpp / batch_search.cpp / selfplay.cpp）で共有する内部ヘルパー。公開 API ではない。
+
+#include "bitbase.hpp"
+#include "mcts.hpp"
+#include "move.hpp"
+#include "movegen.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace mcts_detail {
+    /// ルート用: prior にディリクレノイズを混合。alpha<=0 のときは prior をそのまま返す。
+    inline void applyDirichletToPriors(std::vector<double>& priors, double alpha, double epsilon, std::mt19937& gen) {
+        if (alpha <= 0.0 || priors.empty()) return;
+        const std::size_t K = priors.size();
+        std::gamma_distribution<double> gamma(alpha, 1.0);
+        std::vector<double> noise(K);
+        double sumN = 0.0;
+        for (std::size_t i = 0; i < K; i++) {
+            noise[i] = std::max(gamma(gen), 1e-10);
+            sumN += noise[i];
+        }
+        if (sumN <= 0.0) return;
+        double sumP = 0.0;
+        for (std::size_t i = 0; i < K; i++) {
+            noise[i] /= sumN;
+            priors[i] = (1.0 - epsilon) * priors[i] + epsilon * noise[i];
+            if (priors[i] > 0.0) sumP += priors[i];
+        }
+        if (sumP <= 0.0) return;
+        for (std::size_t i = 0; i < K; i++)
+            priors[i] /= sumP;
+    }
+
+    inline double resultToValue(GameResult r, bool rootWhite) {
+        if (r == GameResult::Draw) return 0.0;
+        if (r == GameResult::WhiteWin) return rootWhite ? 1.0 : -1.0;
+        if (r == GameResult::BlackWin) return rootWhite ? -1.0 : 1.0;
+        return 0.0;
+    }
+
+    inline GameResult winFor(bool white) {
+        return white ? GameResult::WhiteWin : GameResult::BlackWin;
+    }
+
+    /// 手番 whiteToMove の親から見て、子 child が確定負けか
+    inline bool isProvenLoss(const MCTSNode* child, bool whiteToMove) {
+        return child->proven == winFor(!whiteToMove);
+    }
+
+    /// 子の確定結果から node（手番 whiteToMove）の結果を決める。勝ちの子が 1 つでもあれば勝ち、
+    /// 全ての子が確定していれば負け（全て負け）か引き分け。それ以外は Ongoing
+    inline GameResult provenFromChildren(const MCTSNode* node, bool whiteToMove) {
+        if (node->children.empty()) return GameResult::Ongoing;
+        const GameResult win = winFor(whiteToMove);
+        bool allProven = true;
+        bool allLoss = true;
+        for (const MCTSNode* c : node->children) {
+            if (c->proven == win) return win;
+            if (c->proven == GameResult::Ongoing) allProven = false;
+            else if (c->proven != winFor(!whiteToMove)) allLoss = false;
+        }
+        if (!allProven) return GameResult::Ongoing;
+        return allLoss ? winFor(!whiteToMove) : GameResult::Draw;
+    }
+
+    /// 結果 r に確定した node（手番 whiteToMove）の終局までの手数。勝ちなら勝ちの子の最短 + 1、負けなら子の最長 + 1。
+    /// 数える子に手数不明（-1）があれば、勝ちはその子を除き、負けは不明とする
+    inline int provenPliesFromChildren(const MCTSNode* node, GameResult r, bool whiteToMove) {
+        if (r == GameResult::Draw || r == GameResult::Ongoing) return -1;
+        int plies = -1;
+        for (const MCTSNode* c : node->children) {
+            if (c->proven != r) continue;
+            if (r == winFor(whiteToMove)) {
+                if (c->provenPlies >= 0 && (plies < 0 || c->provenPlies + 1 < plies)) plies = c->provenPlies + 1;
+            } else {
+                if (c->provenPlies < 0) return -1;
+                plies = std::max(plies, c->provenPlies + 1);
+            }
+        }
+        return plies;
+    }
+
+    /// node（手番 whiteToMove）が確定したときに、確定できる祖先まで結果と手数を伝播する
+    inline void propagateProven(MCTSNode* node, bool whiteToMove) {
+        for (MCTSNode* p = node->parent; p != nullptr; p = p->parent) {
+            whiteToMove = !whiteToMove;
+            const GameResult r = provenFromChildren(p, whiteToMove);
+            if (r == GameResult::Ongoing) break;
+            p->proven = r;
+            p->provenPlies = static_cast<int16_t>(provenPliesFromChildren(p, r, whiteToMove));
+        }
+    }
+
+    /// 終局ノード（合法手なし）の結果を記録し、solver が有効なら祖先へ伝播する
+    inline void markTerminal(MCTSNode* node, Board& board, const MCTSOptions& options) {
+        node->proven = MoveGen::GetGameResult(board);
+        if (node->proven == GameResult::Ongoing) node->proven = GameResult::Draw;
+        node->provenPlies = node->proven == GameResult::Draw ? -1 : 0;
+        if (options.solver) propagateProven(node, board.GetWhiteToMove());
+    }
+
+    /// ルート以外のノードの局面が options.bitbases に載っていれば、その結果で確定させて solver なら祖先へ伝播する。
+    /// ルートは手を選ぶために展開する。確定させたら true
+    inline bool probeBitbase(MCTSNode* node, const Board& board, const MCTSOptions& options) {
+        if (options.bitbases == nullptr || node->parent == nullptr) return false;
+        const GameResult r = options.bitbases->Probe(board);
+        if (r == GameResult::Ongoing) return false;
+        node->proven = r;
+        if (options.solver) propagateProven(node, board.GetWhiteToMove());
+        return true;
+    }
+
+    /// ルートの確定結果と各手の確定結果を結果に写す
+    inline void fillProven(const MCTSNode* root, MCTSResult& out) {
+        out.provenResult = root->proven;
+        out.provenPlies = root->provenPlies;
+        out.provenMoves.clear();
+        out.provenMovePlies.clear();
+        for (const MCTSNode* c : root->children) {
+            out.provenMoves.push_back(c->proven);
+            out.provenMovePlies.push_back(c->provenPlies);
+        }
+    }
+
+    /// 保存した探索結果 seed でルートとその子の訪問数・値・prior・確定結果を埋める（root は未展開であること）。
+    /// 子は未展開のまま残るので、次に到達したときに評価して展開される。増えたノード数を返す
+    inline long seedRoot(MCTSNode* root, const MCTSResult& seed) {
+        root->N = seed.rootVisits;
+        root->W = seed.rootValue * seed.rootVisits;
+        root->proven = seed.provenResult;
+        root->children.reserve(seed.visits.size());
+        for (std::size_t i = 0; i < seed.visits.size(); i++) {
+            MCTSNode* c = new MCTSNode();
+            c->move_from_parent = seed.visits[i].first;
+            c->parent = root;
+            c->N = seed.visits[i].second;
+            c->W = (i < seed.moveValues.size() ? seed.moveValues[i] : 0.0) * c->N;
+            c->P = i < seed.priors.size() ? seed.priors[i] : 0.0;
+            c->proven = i < seed.provenMoves.size() ? seed.provenMoves[i] : GameResult::Ongoing;
+            root->children.push_back(c);
+        }
+        return static_cast<long>(seed.visits.size());
+    }
+
+    /// Gumbel のルート探索（MCTSOptions::gumbel）。log(prior) に Gumbel ノイズ g を足した上位 gumbel_top_k 手を逐次半減で絞り込み、
+    /// シミュレーションごとにルートのどの子へ進むかを決める。各段は残った手に予算を均等に配り、段の終わりに
+    /// g + log(prior) + σ(q) の上位半分を残す。ルートの子の並びは探索中に変わらないので添字で持つ
+    class GumbelRoot {
+    public:
+        bool Initialized() const { return !logits_.empty(); }
+
+        /// 展開済みの root で初期化する。budget はこの探索で行うシミュレーション数（0 以下なら各段で 1 訪問ずつ）
+        void Init(const MCTSNode* root, int budget, const MCTSOptions& options, std::mt19937& gen) {
+            const std::size_t n = root->children.size();
+            cVisit_ = options.gumbel_c_visit;
+            cScale_ = options.gumbel_c_scale;
+            logits_.resize(n);
+            perturbed_.resize(n);
+            std::uniform_real_distribution<double> uniform(1e-12, 1.0 - 1e-12);
+            considered_.clear();
+            for (std::size_t i = 0; i < n; i++) {
+                logits_[i] = std::log(std::max(root->children[i]->P, 1e-12));
+                perturbed_[i] = logits_[i] - options.gumbel_scale * std::log(-std::log(uniform(gen)));
+                considered_.push_back(i);
+            }
+            std::stable_sort(considered_.begin(), considered_.end(),
+                             [this](std::size_t a, std::size_t b) { return perturbed_[a] > perturbed_[b]; });
+            const std::size_t k = options.gumbel_top_k > 0 ? static_cast<std::size_t>(options.gumbel_top_k) : n;
+            if (considered_.size() > k) considered_.resize(k);
+            phases_ = 1;
+            while ((std::size_t(1) << phases_) < considered_.size()) phases_++;
+            budget_ = std::max(0, budget);
+            startPhase(root);
+        }
+
+        /// 次のシミュレーションで進むルートの子。段の予算を使い切った手が揃ったら半分に絞ってから選ぶ。
+        /// 残った手が全て確定負けなら nullptr（呼び出し側は PUCT で選ぶ）
+        MCTSNode* Next(const MCTSNode* root, bool whiteToMove, bool solver) {
+            while (true) {
+                MCTSNode* best = nullptr;
+                int fewest = 0;
+                for (std::size_t i : considered_) {
+                    MCTSNode* c = root->children[i];
+                    if (solver && isProvenLoss(c, whiteToMove)) continue;
+                    const int visits = c->N + c->N_virtual - base_[i];
+                    if (best == nullptr || visits < fewest) {
+                        best = c;
+                        fewest = visits;
+                    }
+                }
+                if (best == nullptr || fewest < target_ || considered_.size() <= 1) return best;
+                halve(root);
+            }
+        }
+
+        /// 残った手のうち g + log(prior) + σ(q) が最大の手を selectedIndex に、改善方策を improvedPolicy に書く
+        void Fill(const MCTSNode* root, MCTSResult& out) const {
+            if (!Initialized() || considered_.empty()) return;
+            out.selectedIndex = static_cast<int>(*std::max_element(
+                considered_.begin(), considered_.end(),
+                [&](std::size_t a, std::size_t b) { return score(root, a) < score(root, b); }));
+            const double vMix = mixedValue(root);
+            const double sigmaScale = (cVisit_ + maxVisits(root)) * cScale_;
+            out.improvedPolicy.resize(logits_.size());
+            double maxLogit = -1e300;
+            for (std::size_t i = 0; i < logits_.size(); i++) {
+                const MCTSNode* c = root->children[i];
+                const double q = c->N > 0 ? c->W / c->N : vMix;
+                out.improvedPolicy[i] = logits_[i] + sigmaScale * (q + 1.0) * 0.5;
+                maxLogit = std::max(maxLogit, out.improvedPolicy[i]);
+            }
+            double total = 0.0;
+            for (double& x : out.improvedPolicy) {
+                x = std::exp(x - maxLogit);
+                total += x;
+            }
+            for (double& x : out.improvedPolicy) x /= total;
+        }
+
+    private:
+        static double maxVisits(const MCTSNode* root) {
+            int m = 0;
+            for (const MCTSNode* c : root->children) m = std::max(m, c->N);
+            return static_cast<double>(m);
+        }
+
+        /// 訪問した子の平均値の prior 加重平均（未訪問の子の q の代わり）。訪問した子がなければ 0
+        static double mixedValue(const MCTSNode* root) {
+            double sumP = 0.0, sumPQ = 0.0;
+            for (const MCTSNode* c : root->children) {
+                if (c->N <= 0) continue;
+                sumP += c->P;
+                sumPQ += c->P * c->W / c->N;
+            }
+            return sumP > 0.0 ? sumPQ / sumP : 0.0;
+        }
+
+        /// g + log(prior) + σ(q)。q は子の平均値（PUCT と同じ向き）を [0,1] に写したもの
+        double score(const MCTSNode* root, std::size_t i) const {
+            const MCTSNode* c = root->children[i];
+            const double q = c->N > 0 ? c->W / c->N : mixedValue(root);
+            return perturbed_[i] + (cVisit_ + maxVisits(root)) * cScale_ * (q + 1.0) * 0.5;
+        }
+
+        void startPhase(const MCTSNode* root) {
+            base_.assign(root->children.size(), 0);
+            for (std::size_t i : considered_) base_[i] = root->children[i]->N + root->children[i]->N_virtual;
+            target_ = std::max(1, budget_ / (phases_ * static_cast<int>(considered_.size())));
+        }
+
+        void halve(const MCTSNode* root) {
+            std::vector<double> scores(root->children.size());
+            for (std::size_t i : considered_) scores[i] = score(root, i);
+            std::stable_sort(considered_.begin(), considered_.end(),
+                             [&](std::size_t a, std::size_t b) { return scores[a] > scores[b]; });
+            considered_.resize((considered_.size() + 1) / 2);
+            startPhase(root);
+        }
+
+        std::vector<double> logits_;     // log(prior)
+        std::vector<double> perturbed_;  // log(prior) + g
+        std::vector<std::size_t> considered_;
+        std::vector<int> base_;          // 段の開始時の訪問数（仮想訪問を含む）
+        int target_ = 1;                 // 段で 1 手あたりに配る訪問数
+        int phases_ = 1;
+        int budget_ = 0;
+        double cVisit_ = 50.0;
+        double cScale_ = 1.0;
+    };
+
+    inline void deleteTree(MCTSNode* n) {
+        if (!n) return;
+        for (MCTSNode* c : n->children)
+            deleteTree(c);
+        delete n;
+    }
+
+    inline long countNodes(const MCTSNode* n) {
+        long count = 1;
+        for (const MCTSNode* c : n->children) count += countNodes(c);
+        return count;
+    }
+
+    /// 刈ってよい展開済みの非ルートノードを out に集める。部分木に評価待ち・仮想訪問（バッチのワーカーが指している経路）が
+    /// あるノードは刈らない。戻り値は n の部分木にそれがあるか
+    inline bool collectPrunable(MCTSNode* n, std::vector<MCTSNode*>& out) {
+        bool busy = n->pending || n->N_virtual > 0;
+        for (MCTSNode* c : n->children) {
+            if (collectPrunable(c, out)) busy = true;
+        }
+        if (!busy && !n->children.empty() && n->parent != nullptr) out.push_back(n);
+        return busy;
+    }
+
+    /// 訪問の少ない展開済みノードから順に子を捨て、ノード数を targetNodes 以下にする。刈ったノードは N / W / proven を
+    /// 保ったまま未展開のリーフに戻る。子の N は親より必ず小さいので、昇順に処理すれば捨てたノードに触れない。捨てたノード数を返す
+    inline long pruneTree(MCTSNode* root, long& nodeCount, long targetNodes) {
+        std::vector<MCTSNode*> candidates;
+        collectPrunable(root, candidates);
+        std::stable_sort(candidates.begin(), candidates.end(),
+                         [](const MCTSNode* a, const MCTSNode* b) { return a->N < b->N; });
+        long pruned = 0;
+        for (MCTSNode* n : candidates) {
+            if (nodeCount <= targetNodes) break;
+            const long removed = countNodes(n) - 1;
+            for (MCTSNode* c : n->children) deleteTree(c);
+            std::vector<MCTSNode*>().swap(n->children);
+            nodeCount -= removed;
+            pruned += removed;
+        }
+        return pruned;
+    }
+
+    /// memory_limit_bytes を超えていれば木を刈る。刈ったノード数を返す（無効・上限内なら 0）
+    inline long enforceMemoryLimit(MCTSNode* root, long& nodeCount, const MCTSOptions& options) {
+        if (options.memory_limit_bytes == 0 || MCTSTreeBytes(nodeCount) <= options.memory_limit_bytes) return 0;
+        const long limitNodes = static_cast<long>(options.memory_limit_bytes / (sizeof(MCTSNode) + sizeof(MCTSNode*)));
+        return pruneTree(root, nodeCount, limitNodes / 4 * 3);
+    }
+
+    inline std::vector<std::string> movesToUci(const std::vector<Move>& moves) {
+        std::vector<std::string> out;
+        out.reserve(moves.size());
+        for (const Move& m : moves) out.push_back(MoveToUci(m));
+        return out;
+    }
+
+    /// 評価器の prior を合法手数 n の確率分布に正規化。長さ不一致・全て非正なら一様。
+    inline std::vector<double> normalizePriors(const std::vector<double>& priors, std::size_t n) {
+        double sumP = 0.0;
+        if (priors.size() == n) {
+            for (double x : priors) sumP += (x > 0.0 ? x : 0.0);
+        }
+        const double uniformP = 1.0 / static_cast<double>(n);
+        std::vector<double> p(n);
+        for (std::size_t i = 0; i < n; i++) {
+            if (sumP > 0.0 && priors[i] > 0.0)
+                p[i] = priors[i] / sumP;
+            else
+                p[i] = uniformP;
+        }
+        return p;
+    }
+
+    /// PFU: 未訪問子の初期値。parent_value - pfu_scale/sqrt(parent_N) を [-1,1] にクリップ。pfu_scale<=0 または parent->N==0 なら 0。
+    inline double getPfuInitialValue(const MCTSNode* parent, const MCTSNode* child, double pfu_scale) {
+        if (pfu_scale <= 0.0 || parent->N <= 0 || child->N > 0) return 0.0;
+        double parentValue = parent->W / static_cast<double>(parent->N);
+        double delta = pfu_scale / std::sqrt(static_cast<double>(parent->N));
+        double v = parentValue - delta;
+        if (v < -1.0) return -1.0;
+        if (v > 1.0) return 1.0;
+        return v;
+    }
+
+    /// collect_stats 用の区間計測。Lap で前回の区切りからの時間を足し込む。無効なら時計を読まない
+    class StatsClock {
+    public:
+        explicit StatsClock(bool enabled) : enabled_(enabled) { Restart(); }
+
+        void Restart() {
+            if (enabled_) last_ = std::chrono::steady_clock::now();
+        }
+
+        void Lap(double& accMs) {
+            if (!enabled_) return;
+            const auto now = std::chrono::steady_clock::now();
+            accMs += std::chrono::duration<double, std::milli>(now - last_).count();
+            last_ = now;
+        }
+
+    private:
+        bool enabled_;
+        std::chrono::steady_clock::time_point last_;
+    };
+
+    /// MCTSStats のカウンタを集め、Finish で平均を埋める
+    class StatsRecorder {
+    public:
+        MCTSStats stats;
+
+        /// 1 回のシミュレーションが深さ depth のノードで終わった
+        void Simulation(int depth) {
+            depthSum_ += depth;
+            simulations_++;
+            stats.maxDepth = std::max(stats.maxDepth, depth);
+        }
+
+        /// 評価器を n 局面で 1 回呼んだ
+        void EvalCall(std::size_t n) {
+            const int fill = static_cast<int>(n);
+            stats.minBatchFill = (stats.evalCalls == 0) ? fill : std::min(stats.minBatchFill, fill);
+            stats.evalCalls++;
+            stats.evalPositions += static_cast<long>(n);
+        }
+
+        MCTSStats Finish() const {
+            MCTSStats out = stats;
+            out.avgDepth = simulations_ > 0 ? static_cast<double>(depthSum_) / simulations_ : 0.0;
+            out.avgBatchFill = out.evalCalls > 0 ? static_cast<double>(out.evalPositions) / out.evalCalls : 0.0;
+            return out;
+        }
+
+    private:
+        long depthSum_ = 0;
+        long simulations_ = 0;
+    };
+
+    /// 探索予算（反復数・時間・ノード数・停止フラグ）と早期終了（smart pruning / 収束）の判定
+    class SearchBudget {
+    public:
+        SearchBudget(int iterations, const MCTSOptions& options)
+            : iterations_(iterations), options_(options), start_(std::chrono::steady_clock::now()) {}
+
+        /// completed: 完了した反復数, nodes: 木のノード数
+        bool ShouldStop(const MCTSNode* root, int completed, long nodes) {
+            if (completed >= iterations_) return stop(MCTSStopReason::Iterations);
+            if (options_.stop_flag && options_.stop_flag->load(std::memory_order_relaxed))
+                return stop(MCTSStopReason::Stopped);
+            if (options_.solver && root->proven != GameResult::Ongoing) return stop(MCTSStopReason::Proven);
+            if (options_.node_limit > 0 && nodes >= options_.node_limit) return stop(MCTSStopReason::NodeLimit);
+            double remaining = static_cast<double>(iterations_ - completed);
+            if (options_.time_limit_ms > 0.0) {
+                const double elapsed = ElapsedMs();
+                if (elapsed >= options_.time_limit_ms) return stop(MCTSStopReason::TimeLimit);
+                if (completed > 0 && elapsed > 0.0)
+                    remaining = std::min(remaining, completed * (options_.time_limit_ms - elapsed) / elapsed);
+            }
+            if (options_.smart_pruning && completed > 0 && !root->children.empty()) {
+                if (root->children.size() == 1) return stop(MCTSStopReason::SmartPruning);
+                int best = 0, second = 0;
+                for (const MCTSNode* c : root->children) {
+                    if (c->N > best) { second = best; best = c->N; }
+                    else if (c->N > second) second = c->N;
+                }
+                if (best - second > remaining) return stop(MCTSStopReason::SmartPruning);
+            }
+            if (options_.convergence_kld > 0.0 && completed - lastCheck_ >= std::max(1, options_.convergence_interval)) {
+                lastCheck_ = completed;
+                if (converged(root)) return stop(MCTSStopReason::Converged);
+            }
+            return false;
+        }
+
+        MCTSStopReason Reason() const { return reason_; }
+
+        double ElapsedMs() const {
+            return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start_).count();
+        }
+
+    private:
+        bool stop(MCTSStopReason r) {
+            reason_ = r;
+            return true;
+        }
+
+        /// 前回チェック時の訪問分布との KL(cur || prev)。初回は比較対象がないので false
+        bool converged(const MCTSNode* root) {
+            std::vector<double> cur(root->children.size());
+            double total = 0.0;
+            for (std::size_t i = 0; i < cur.size(); i++) {
+                cur[i] = static_cast<double>(root->children[i]->N);
+                total += cur[i];
+            }
+            if (total <= 0.0) return false;
+            for (double& x : cur) x /= total;
+            bool done = false;
+            if (prevDist_.size() == cur.size()) {
+                double kld = 0.0;
+                for (std::size_t i = 0; i < cur.size(); i++)
+                    if (cur[i] > 0.0) kld += cur[i] * std::log(cur[i] / std::max(prevDist_[i], 1e-9));
+                done = kld < options_.convergence_kld;
+            }
+            prevDist_ = std::move(cur);
+            return done;
+        }
+
+        int iterations_;
+        const MCTSOptions& options_;
+        std::chrono::steady_clock::time_point start_;
+        MCTSStopReason reason_ = MCTSStopReason::Iterations;
+        int lastCheck_ = 0;
+        std::vector<double> prevDist_;
+    };
+}
+
+#endif
@@ -0,0 +1,245 @@
+#ifndef MCTS_SEARCH_HPP
+#define MCTS_SEARCH_HPP
+
+// 評価器・プレイアウトを型で受け取る逐次 MCTS。評価呼び出しが探索ループにインライン展開される。
+// MCTSOptions の std::function による RunMCTS は FunctionEvaluator / OptionsPlayout での実体化。
+// SearchMCTS は呼び出しをまたいで木を持ち続ける場合（MCTSTree）に使う。
+//
+// Evaluator に必要なメンバ:
+//   bool Cacheable() const                      — options.eval_cache に結果を載せてよいか
+//   bool Value(const Board&, bool rootWhite, double& value)
+//                                               — ルート手番から見た値 [-1,1]。false ならプレイアウトで決める
+//   void Priors(const Board&, const std::vector<Move>&, std::vector<double>& priors)
+//                                               — 合法手の prior（未正規化で可。空なら一様）
+// Playout に必要なメンバ:
+//   double operator()(const Board&, std::mt19937&) — 白から見た値 [-1,1]
+
+#include "board.hpp"
+#include "eval_cache.hpp"
+#include "mcts.hpp"
+#include "mcts_detail.hpp"
+#include "movegen.hpp"
+#include "playout.hpp"
+#include <cmath>
+#include <random>
+#include <vector>
+
+/// MCTSOptions の prior_fn / see_prior / value_fn / static_eval をそのまま使う評価器
+struct FunctionEvaluator {
+    const MCTSOptions& options;
+
+    explicit FunctionEvaluator(const MCTSOptions& opts) : options(opts) {}
+
+    bool Cacheable() const { return static_cast<bool>(options.value_fn); }
+
+    bool Value(const Board& board, bool rootWhite, double& value) {
+        if (options.value_fn) {
+            value = options.value_fn(board);
+            return true;
+        }
+        if (options.static_eval) {
+            const double whiteValue = std::tanh(board.GetStaticEval() / options.static_eval_scale);
+            value = rootWhite ? whiteValue : -whiteValue;
+            return true;
+        }
+        return false;
+    }
+
+    void Priors(const Board& board, const std::vector<Move>& moves, std::vector<double>& priors) {
+        if (options.prior_fn)
+            priors = options.prior_fn(board, moves);
+        else if (options.see_prior)
+            priors = SEEPriors(board, moves, options.see_prior_scale);
+    }
+};
+
+/// 組み込み静的評価（Board::GetStaticEval）と一様 prior
+struct StaticEvaluator {
+    double scale = 400.0;
+
+    bool Cacheable() const { return false; }
+
+    bool Value(const Board& board, bool rootWhite, double& value) const {
+        const double whiteValue = std::tanh(board.GetStaticEval() / scale);
+        value = rootWhite ? whiteValue : -whiteValue;
+        return true;
+    }
+
+    void Priors(const Board&, const std::vector<Move>&, std::vector<double>&) const {}
+};
+
+/// MCTSOptions::playout に従うプレイアウト
+struct OptionsPlayout {
+    const PlayoutOptions& options;
+
+    explicit OptionsPlayout(const PlayoutOptions& opts) : options(opts) {}
+
+    double operator()(const Board& board, std::mt19937& gen) const { return RunPlayout(board, gen, options); }
+};
+
+/// 既存の木 root（rootBoard の局面）に iterations 回までシミュレーションを追加する。木は呼び出し側が持ち続ける。
+/// nodeCount は木のノード数で、展開したぶん増やす
+template <class Evaluator, class Playout>
+MCTSResult SearchMCTS(MCTSNode* root, long& nodeCount, const Board& rootBoard, int iterations, std::mt19937& gen,
+                      const MCTSOptions& options, Evaluator& evaluator, Playout& playout) {
+    using namespace mcts_detail;
+    MCTSResult out;
+    out.rootValue = 0.0;
+    out.rootVisits = 0;
+
+    const double c_puct = options.c_puct;
+    EvalCache* cache = evaluator.Cacheable() ? options.eval_cache : nullptr;
+    const bool rootWhite = rootBoard.GetWhiteToMove();
+    SearchBudget budget(iterations, options);
+    std::vector<Move> moves;
+    std::vector<double> priors;
+
+    auto backup = [](MCTSNode* leaf, double value) {
+        double sign = 1.0;
+        for (MCTSNode* p = leaf; p != nullptr; p = p->parent) {
+            p->N++;
+            p->W += sign * value;
+            sign = -sign;
+        }
+    };
+
+    StatsRecorder stats;
+    StatsClock clock(options.collect_stats);
+    MCTSStats& st = stats.stats;
+    GumbelRoot gumbel;
+
+    for (int iter = 0; !budget.ShouldStop(root, iter, nodeCount); iter++) {
+        st.nodesPruned += enforceMemoryLimit(root, nodeCount, options);
+        Board board = rootBoard;
+        MCTSNode* node = root;
+        int depth = 0;
+        clock.Restart();
+
+        while (true) {
+            if (node->proven == GameResult::Ongoing && node->children.empty()) {
+                clock.Lap(st.selectMs);
+                MoveGen::GenerateLegalMoves(board, moves);
+                if (moves.empty())
+                    markTerminal(node, board, options);
+                else if (probeBitbase(node, board, options))
+                    st.bitbaseHits++;
+                clock.Lap(st.expandMs);
+            }
+            // 終局・確定済みのノードは評価し直さず確定値をバックアップする
+            if (node->proven != GameResult::Ongoing) {
+                clock.Lap(st.selectMs);
+                backup(node, resultToValue(node->proven, rootWhite));
+                clock.Lap(st.backupMs);
+                stats.Simulation(depth);
+                break;
+            }
+
+            if (node->children.empty()) {
+                double value = 0.0;
+                std::vector<double> p;
+                // キャッシュは局面の手番から見た値で持つので、ルート手番から見た値との間で向きを直す
+                const double toMove = (board.GetWhiteToMove() == rootWhite) ? 1.0 : -1.0;
+                const bool cached = cache != nullptr && cache->Lookup(board.GetZobristHash(), moves, p, value);
+                if (cached) {
+                    value *= toMove;
+                    st.cacheHits++;
+                } else {
+                    if (!evaluator.Value(board, rootWhite, value)) {
+                        const double whiteValue = playout(board, gen);
+                        value = rootWhite ? whiteValue : -whiteValue;
+                    }
+                    priors.clear();
+                    evaluator.Priors(board, moves, priors);
+                    p = normalizePriors(priors, moves.size());
+                    if (cache) cache->Insert(board.GetZobristHash(), moves, p, value * toMove);
+                    stats.EvalCall(1);
+                }
+                clock.Lap(st.evalMs);
+                backup(node, value);
+                clock.Lap(st.backupMs);
+                if (node->parent == nullptr && options.dirichlet_alpha > 0.0 && !options.gumbel)
+                    applyDirichletToPriors(p, options.dirichlet_alpha, options.dirichlet_epsilon, gen);
+                node->children.reserve(moves.size());
+                for (std::size_t i = 0; i < moves.size(); i++) {
+                    MCTSNode* c = new MCTSNode();
+                    c->move_from_parent = moves[i];
+                    c->parent = node;
+                    c->N = 0;
+                    c->W = 0.0;
+                    c->P = p[i];
+                    node->children.push_back(c);
+                }
+                nodeCount += static_cast<long>(moves.size());
+                st.nodesCreated += static_cast<long>(moves.size());
+                clock.Lap(st.expandMs);
+                stats.Simulation(depth);
+                break;
+            }
+
+            MCTSNode* best = nullptr;
+            double bestScore = -1e99;
+            const int parentN = node->N;
+            const bool whiteToMove = board.GetWhiteToMove();
+            // Gumbel のルート探索では逐次半減の配分でルートの子を選ぶ（残りが全て確定負けなら PUCT に任せる）
+            if (options.gumbel && node == root) {
+                if (!gumbel.Initialized()) gumbel.Init(root, iterations - iter, options, gen);
+                best = gumbel.Next(root, whiteToMove, options.solver);
+            }
+            if (best == nullptr) {
+                for (MCTSNode* c : node->children) {
+                    if (options.solver && isProvenLoss(c, whiteToMove)) continue;
+                    double score = c_puct * c->P * std::sqrt(static_cast<double>(parentN + 1)) / (1.0 + c->N);
+                    if (c->N > 0)
+                        score += c->W / c->N;
+                    else if (options.pfu_scale > 0.0)
+                        score += getPfuInitialValue(node, c, options.pfu_scale);
+                    if (score > bestScore) {
+                        bestScore = score;
+                        best = c;
+                    }
+                }
+            }
+            if (!best) break;
+            board.MakeMove(best->move_from_parent);
+            node = best;
+            depth++;
+        }
+    }
+
+    out.rootVisits = root->N;
+    out.rootValue = (root->N > 0) ? (root->W / root->N) : 0.0;
+    out.stopReason = budget.Reason();
+    out.elapsedMs = budget.ElapsedMs();
+    for (MCTSNode* c : root->children) {
+        out.visits.push_back({c->move_from_parent, c->N});
+        out.priors.push_back(c->P);
+        out.moveValues.push_back(c->N > 0 ? c->W / c->N : 0.0);
+    }
+    gumbel.Fill(root, out);
+    fillProven(root, out);
+    out.stats = stats.Finish();
+    out.stats.treeBytes = MCTSTreeBytes(nodeCount);
+    return out;
+}
+
+template <class Evaluator, class Playout>
+MCTSResult RunMCTS(const Board& rootBoard, int iterations, std::mt19937& gen, const MCTSOptions& options,
+                   Evaluator& evaluator, Playout& playout) {
+    if (iterations <= 0) {
+        MCTSResult out;
+        out.rootValue = 0.0;
+        out.rootVisits = 0;
+        return out;
+    }
+    MCTSNode* root = new MCTSNode();
+    root->parent = nullptr;
+    root->N = 0;
+    root->W = 0.0;
+    root->P = 0.0;
+    long nodeCount = 1;
+    MCTSResult out = SearchMCTS(root, nodeCount, rootBoard, iterations, gen, options, evaluator, playout);
+    mcts_detail::deleteTree(root);
+    return out;
+}
+
+#endif
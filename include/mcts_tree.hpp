@@ -0,0 +1,46 @@
+#ifndef MCTS_TREE_HPP
+#define MCTS_TREE_HPP
+
+#include "board.hpp"
+#include "mcts.hpp"
+#include "move.hpp"
+#include <random>
+#include <vector>
+
+/// 探索をまたいで木を持ち続ける逐次 MCTS。思考継続（pondering）と、実際に指された手の先の部分木の再利用に使う。
+/// 評価は MCTSOptions の prior_fn / see_prior / value_fn / static_eval / playout（バッチ評価は使わない）
+class MCTSTree {
+public:
+    MCTSTree();
+    ~MCTSTree();
+    MCTSTree(const MCTSTree&) = delete;
+    MCTSTree& operator=(const MCTSTree&) = delete;
+
+    /// ルート局面を board にする。現在のルートと同じ局面か、ルートから 2 手（自分と相手の 1 手ずつ）で到達する
+    /// 展開済みの局面なら、その部分木を残して true を返す。それ以外は木を作り直して false
+    bool SetPosition(const Board& board);
+    /// 現在の木に iterations 回まで（options の打ち切り条件つき）シミュレーションを追加する。
+    /// 結果の rootVisits / visits は再利用した訪問を含む
+    MCTSResult Search(int iterations, std::mt19937& gen, const MCTSOptions& options);
+    /// 木を捨てる（ルート局面は保つ）
+    void Clear();
+
+    const Board& RootBoard() const { return rootBoard_; }
+    int RootVisits() const { return root_->N; }
+    long NodeCount() const { return nodeCount_; }
+    /// 木が使うメモリ（MCTSTreeBytes）。上限は Search に渡す options.memory_limit_bytes
+    std::size_t MemoryBytes() const { return MCTSTreeBytes(nodeCount_); }
+    /// ルートの子のうち move の平均値（ルート手番から見た値 [-1,1]）。未訪問・該当なしなら 0
+    double MoveValue(const Move& move) const;
+    /// ルートから指すべき子（確定勝ち優先、確定負けを除いた最多訪問）を辿った読み筋（最大 maxLength 手、未訪問の子で止める）
+    std::vector<Move> PrincipalVariation(int maxLength) const;
+
+private:
+    void reset();
+
+    Board rootBoard_;
+    MCTSNode* root_ = nullptr;
+    long nodeCount_ = 0;
+};
+
+#endif
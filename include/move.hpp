@@ -2,6 +2,7 @@
 #define MOVE_HPP
 
 #include "bitboard.hpp"
+#include <cstdint>
 #include <string>
 
 enum PieceType {
@@ -14,6 +15,9 @@ enum PieceType {
     KING = 6
 };
 
+/// 駒の価値（センチポーン）。SEE とプレイアウト打ち切り時の駒得評価で使う。キングは交換で取られない前提の大きな値
+const int PIECE_VALUE[7] = {0, 100, 320, 330, 500, 900, 20000};
+
 enum class GameResult { WhiteWin = 1, BlackWin = -1, Draw = 0, Ongoing = 2 };
 
 struct Move {
@@ -30,8 +34,18 @@ struct Move {
         : from(f), to(t), pieceType(pt), capturedPiece(cp), promotionPiece(pp) {}
 };
 
+/// 方策（policy）ベクトルの次元: from*64+to の 4096 + アンダープロモーション 144（色 2 × 元の筋 8 × 方向 3 × 駒 3）
+const int POLICY_SIZE = 4096 + 144;
+
 std::string SquareToStr(Square s);
 Square StrToSquare(const std::string& s);
+std::string MoveToUci(const Move& m);
+/// 手を [0, POLICY_SIZE) の添字に写す。通常手とクイーン昇格は from*64+to
+int MoveToPolicyIndex(const Move& m);
+/// 16 ビットの手ハンドル: from | to<<6 | 昇格駒<<12（NO_PIECE=0）。駒種・取った駒は含まない
+uint16_t PackMove(const Move& m);
+/// PackMove の逆。駒種・取った駒は NO_PIECE のまま（UCI 表記と policy 添字には足りる）
+Move UnpackMove(uint16_t handle);
 
 #endif
 
@@ -3,9 +3,12 @@
 
 #include "board.hpp"
 #include <functional>
+#include <mutex>
 #include <random>
 #include <vector>
 
+class Bitbases;
+
 class MoveGen {
 private:
     // ポーンの移動テーブル（色ごと）
@@ -19,7 +22,7 @@ private:
     static U64 knightMoves[64];
     static U64 queenMoves[64];
     static U64 kingMoves[64];
-    static bool initialized;
+    static std::once_flag initFlag;  // 並行な探索から同時に Init されても 1 回だけ初期化する
     
     static void InitPawnMoves();
     static void InitRookMoves();
@@ -40,11 +43,19 @@ public:
     static U64 GetKnightMoves(Square square);
     static U64 GetQueenMoves(Square square, U64 occupancy = 0);
     static U64 GetKingMoves(Square square);
+    /// 飛び駒の利きの実装（Init 後に決まる）: PEXT で表を引く "pext"（CpuFeatures::fastPext のとき）か、1 マスずつ辿る "loop"
+    static const char* SliderBackend();
     static void GenerateLegalMoves(Board& board, std::vector<Move>& moves);
     /// 終局結果を返す（白勝ち=1, 黒勝ち=-1, 引き分け=0, 進行中=Ongoing）
     static GameResult GetGameResult(Board& board);
-    /// ランダムプレイアウト
-    static GameResult DoRandomPlayout(Board board, std::mt19937& gen);
+    /// ランダムプレイアウト。bitbases があれば、載っている局面に着いた時点でその結果を返す
+    static GameResult DoRandomPlayout(Board board, std::mt19937& gen, const Bitbases* bitbases = nullptr);
+    /// square に利きのある駒（両色）。occupancy で飛び駒の遮りを判定する
+    static U64 GetAttackersTo(const Board& board, Square square, U64 occupancy);
+    /// 静的交換評価（手番側から見たセンチポーン）。move.to での取り合いを安い駒から順に進めた結果。
+    /// 取り返した駒の後ろに並んだ飛び駒（X 線）も加える。取らない手なら、動かした駒が取られるかどうか（負なら駒をただで渡す手）。
+    /// ピンは考えない
+    static int StaticExchangeEval(const Board& board, const Move& move);
 };
 
 #endif
\ No newline at end of file
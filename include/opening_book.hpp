@@ -0,0 +1,68 @@
+#ifndef OPENING_BOOK_HPP
+#define OPENING_BOOK_HPP
+
+#include "bitboard.hpp"
+#include "board.hpp"
+#include "mcts.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+/// 定跡ファイル（探索結果の保存）の形式（リトルエンディアン）
+///   ファイルヘッダ: "BCBK" + uint32 バージョン + uint64 局面数
+///   索引: 局面数 × (uint64 Zobrist ハッシュ, uint64 レコード位置)。ハッシュの昇順
+///   レコード: float rootValue, uint32 rootVisits, int8 provenResult, uint16 n,
+///             n × (uint16 PackMove, uint32 訪問数, float 平均値, float prior, int8 確定結果)
+/// 確定結果は GameResult の値（Ongoing は 2）
+const char BOOK_MAGIC[4] = {'B', 'C', 'B', 'K'};
+const uint32_t BOOK_VERSION = 1;
+const std::size_t BOOK_FILE_HEADER_SIZE = 16;
+const std::size_t BOOK_INDEX_ENTRY_SIZE = 16;
+const std::size_t BOOK_RECORD_FIXED_SIZE = 4 + 4 + 1 + 2;
+const std::size_t BOOK_MOVE_SIZE = 2 + 4 + 4 + 4 + 1;
+
+/// 定跡ファイルを mmap して Zobrist ハッシュで引く。読み取り専用なので複数スレッドから同時に Lookup してよい
+class OpeningBook {
+public:
+    explicit OpeningBook(const std::string& path);
+    ~OpeningBook();
+    OpeningBook(const OpeningBook&) = delete;
+    OpeningBook& operator=(const OpeningBook&) = delete;
+
+    /// board の局面が載っていれば、保存した探索結果を合法手と照合して out に書き true を返す。
+    /// 手が合法手と合わない（ハッシュの衝突・壊れたレコード）場合は false。out の stopReason は Book
+    bool Lookup(const Board& board, MCTSResult& out) const;
+    bool Contains(U64 hash) const { return find(hash) != nullptr; }
+    std::size_t Size() const { return count_; }
+
+private:
+    /// hash のレコードの先頭。なければ nullptr
+    const uint8_t* find(U64 hash) const;
+
+    const uint8_t* data_ = nullptr;
+    std::size_t size_ = 0;
+    std::size_t count_ = 0;
+};
+
+/// 探索結果を集めて定跡ファイルを書く。同じ局面が複数回 Add されたらルート訪問数の多い方を残す
+class OpeningBookWriter {
+public:
+    /// 訪問のない結果（終局局面・iterations=0）は載せず false を返す
+    bool Add(const Board& board, const MCTSResult& result);
+    std::size_t Size() const { return records_.size(); }
+    /// 一時ファイルに書いてから path へ rename する（path を mmap 中の読み手は古い内容を読み続けられる）
+    void Write(const std::string& path) const;
+
+private:
+    std::map<U64, std::string> records_;  // ハッシュ -> 直列化したレコード
+};
+
+/// positions をそれぞれ iterations 回（options の打ち切り条件つき）RunMCTSMany で並列に探索し、定跡ファイルを書く。
+/// seeds と numThreads は RunMCTSMany と同じ。書いた局面数を返す
+std::size_t BuildOpeningBook(const std::string& path, const std::vector<Board>& positions, int iterations,
+                             const MCTSOptions& options, const std::vector<unsigned int>& seeds = {},
+                             int numThreads = 0);
+
+#endif
@@ -0,0 +1,44 @@
+#ifndef PLAYOUT_HPP
+#define PLAYOUT_HPP
+
+#include "board.hpp"
+#include <random>
+#include <string>
+#include <vector>
+
+class Bitbases;
+
+/// プレイアウトで手を選ぶ方針
+enum class PlayoutPolicy {
+    Uniform,        // 合法手から一様に選ぶ（MoveGen::DoRandomPlayout と同じ）
+    CaptureBiased,  // 取る手・昇格を capture_weight 倍の重みで選ぶ
+    CheckBiased,    // さらに王手を check_weight 倍の重みで選ぶ
+    SEEFiltered     // 静的交換評価が負の取る手を除き、得する取る手を capture_weight 倍で選ぶ
+};
+
+struct PlayoutOptions {
+    PlayoutPolicy policy = PlayoutPolicy::Uniform;
+    /// この手数で打ち切り、駒得から値を決める。0 なら終局（詰み・ステイルメイト・50 手・千日手）まで
+    int max_plies = 0;
+    double capture_weight = 8.0;
+    double check_weight = 8.0;
+    /// 打ち切り時の値 = tanh(駒得センチポーン / eval_scale)
+    double eval_scale = 400.0;
+    /// 終盤ビットベース（所有しない）。載っている局面に着いたらその結果で打ち切る。nullptr なら無効
+    const Bitbases* bitbases = nullptr;
+};
+
+/// 白から見た駒得（センチポーン、キングを除く）
+int MaterialBalance(const Board& board);
+
+/// 静的交換評価による手の prior（合計 1）。重みは exp(SEE / scale) で、得する取る手を大きく、
+/// 駒をただで渡す手（SEE が負）を小さくし、駒の損得のない手は同じ重みにする
+std::vector<double> SEEPriors(const Board& board, const std::vector<Move>& moves, double scale = 200.0);
+
+/// options に従ってプレイアウトし、白から見た値 [-1, 1] を返す（白勝ち 1、黒勝ち -1、引き分け 0）
+double RunPlayout(Board board, std::mt19937& gen, const PlayoutOptions& options);
+
+/// "uniform" / "capture" / "check" / "see" を PlayoutPolicy に変換。不明な名前は std::invalid_argument
+PlayoutPolicy PlayoutPolicyFromString(const std::string& name);
+
+#endif
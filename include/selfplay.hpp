@@ -0,0 +1,87 @@
+#ifndef SELFPLAY_HPP
+#define SELFPLAY_HPP
+
+#include "board.hpp"
+#include "mcts.hpp"
+#include "move.hpp"
+#include "training_data.hpp"
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace mcts_detail {
+    struct EvalBatch;
+}
+
+struct SelfPlayConfig {
+    int num_games = 64;
+    int iterations = 200;          // 1 手あたりのシミュレーション数
+    int target_batch_size = 256;   // 1 回の評価器呼び出しに載せるリーフ数の上限
+    int workers_per_tree = 8;      // 1 木あたりの同時リーフ数。大きいほど仮想損失で探索が劣化する
+    int max_plies = 400;           // これを超えた局は引き分けとして打ち切る
+    std::string start_fen;         // 空なら初期局面
+    /// 手の選択温度。temperature_plies 手目までは訪問数^(1/temperature) に比例してサンプルし、以降（または 0 のとき）は最多訪問手。
+    /// 確定負けの手は、他に手がない場合を除いてサンプルしない
+    double temperature = 0.0;
+    int temperature_plies = 30;
+    /// options.dirichlet_alpha によるルートノイズをこの手数まで適用する。負なら全手
+    int dirichlet_plies = -1;
+    /// 空でなければ終局した局の学習レコードをこのファイルへ追記する（バックグラウンドスレッドで書き込み）
+    std::string output_path;
+    /// batch_array_fn・batch_eval_fn・batch_prior_fn + batch_value_fn のいずれかが必須。c_puct / Dirichlet / eval_cache もここで指定。
+    /// options.gumbel ならルートは Gumbel 探索で、学習レコードの方策は改善方策になり、温度を使わない手は逐次半減で残った手を指す
+    MCTSOptions options;
+};
+
+struct SelfPlayGame {
+    std::string startFen;
+    std::vector<Move> moves;
+    GameResult result = GameResult::Ongoing;
+    /// 各手番の局面・訪問分布・ルート値。終局時に result を埋める。output_path 指定時は書き出し後に空にする
+    std::vector<TrainingRecord> records;
+};
+
+/// 多数の自己対局とその探索木を同時に進め、全木のリーフを 1 回の batch_eval_fn 呼び出しにまとめる。
+/// 1 本の木から大きなバッチを作るより仮想損失が浅く済み、評価器には常に大きなバッチを渡せる。
+class SelfPlayPool {
+public:
+    SelfPlayPool(const SelfPlayConfig& config, unsigned int seed);
+    ~SelfPlayPool();
+    SelfPlayPool(const SelfPlayPool&) = delete;
+    SelfPlayPool& operator=(const SelfPlayPool&) = delete;
+
+    /// 全局の探索を評価器呼び出し 1 回分進め、探索が終わった局は最多訪問手を指す。進行中の局が残っていれば true
+    bool Step();
+    /// 全局が終わるまで Step を繰り返し、学習データを書き切る
+    void Run();
+    /// 学習データの書き込みスレッドを止めてファイルを閉じる。書き込みに失敗していれば std::runtime_error
+    void Close();
+
+    const std::vector<SelfPlayGame>& Games() const { return games_; }
+    int ActiveGames() const;
+    long EvalCalls() const { return evalCalls_; }
+    long EvaluatedLeaves() const { return evaluatedLeaves_; }
+    long RecordsWritten() const { return writer_ ? writer_->RecordsWritten() : 0; }
+
+private:
+    struct Slot;
+
+    void startSearch(Slot& slot);
+    void playMove(Slot& slot);
+    Move chooseMove(const MCTSResult& res, int ply, bool whiteToMove);
+    void finishGame(Slot& slot, GameResult result);
+
+    SelfPlayConfig config_;
+    MCTSOptions noNoiseOptions_;  // dirichlet_plies 以降の探索用
+    std::mt19937 gen_;
+    std::vector<SelfPlayGame> games_;
+    std::vector<std::unique_ptr<Slot>> slots_;
+    std::size_t nextSlot_ = 0;  // Gather の開始位置（局ごとの偏りを避けるため毎回ずらす）
+    long evalCalls_ = 0;
+    long evaluatedLeaves_ = 0;
+    std::unique_ptr<TrainingDataWriter> writer_;
+    std::vector<std::unique_ptr<mcts_detail::EvalBatch>> batchPool_;  // Step ごとに使い回す評価バッチ
+};
+
+#endif
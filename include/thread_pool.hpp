@@ -0,0 +1,37 @@
+#ifndef THREAD_POOL_HPP
+#define THREAD_POOL_HPP
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/// 固定数のワーカースレッドを持つ単純なスレッドプール
+class ThreadPool {
+public:
+    /// numThreads<=0 ならハードウェアスレッド数
+    explicit ThreadPool(int numThreads = 0);
+    ~ThreadPool();
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    int NumThreads() const { return static_cast<int>(threads_.size()); }
+    void Submit(std::function<void()> task);
+    /// [0, n) をスレッド数程度のチャンクに分けて fn(begin, end) を並列実行し、全て終わるまで待つ。
+    /// fn が投げた最初の例外は呼び出し側に再送出する
+    void ParallelFor(std::size_t n, const std::function<void(std::size_t, std::size_t)>& fn);
+
+private:
+    void run();
+
+    std::vector<std::thread> threads_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<std::function<void()>> tasks_;
+    bool stopping_ = false;
+};
+
+#endif
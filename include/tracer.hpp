@@ -0,0 +1,60 @@
+#ifndef TRACER_HPP
+#define TRACER_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+/// 探索の区間（span）をスレッドごとに記録し、Chrome の trace_event 形式（chrome://tracing / Perfetto）の JSON に書き出す。
+/// 記録先は容量固定の配列で、各スレッドは atomic な添字で自分の枠を取って書く（ロックなし）。容量を超えた区間は捨てて数える。
+/// MCTSOptions::tracer に渡すとバッチ探索（RunMCTSBatch）の各段階が記録される。
+/// WriteJson / Clear は記録中のスレッドがいないとき（探索が終わってから）呼ぶ
+class Tracer {
+public:
+    explicit Tracer(std::size_t capacity = 1u << 20);
+
+    /// name は静的な文字列（リテラル）であること。時刻は Now() の値
+    void Record(const char* name, double startUs, double endUs);
+    /// 構築（または Clear）からの経過マイクロ秒
+    double Now() const;
+
+    std::size_t Size() const;
+    std::size_t Dropped() const;
+    void Clear();
+    /// 区間を "X"（complete）イベントとして書く。tid はスレッド番号（終了したスレッドの番号は使い回す）
+    void WriteJson(const std::string& path) const;
+
+private:
+    struct Event {
+        const char* name;
+        uint32_t tid;
+        double startUs;
+        double durUs;
+    };
+
+    std::unique_ptr<Event[]> events_;
+    std::size_t capacity_;
+    std::atomic<std::size_t> next_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+/// スコープの区間を tracer に記録する。tracer が nullptr なら何もしない
+class TraceSpan {
+public:
+    TraceSpan(Tracer* tracer, const char* name) : tracer_(tracer), name_(name), startUs_(tracer ? tracer->Now() : 0.0) {}
+    ~TraceSpan() {
+        if (tracer_) tracer_->Record(name_, startUs_, tracer_->Now());
+    }
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+
+private:
+    Tracer* tracer_;
+    const char* name_;
+    double startUs_;
+};
+
+#endif
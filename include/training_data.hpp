@@ -0,0 +1,130 @@
+#ifndef TRAINING_DATA_HPP
+#define TRAINING_DATA_HPP
+
+#include "bitboard.hpp"
+#include "board.hpp"
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/// 学習データファイルの形式（リトルエンディアン）
+///   ファイルヘッダ: "BCTR" + uint32 バージョン
+///   レコード: PackedPosition（27 バイト）, int8 result, float rootValue, uint16 n, n × (uint16 policy 添字, uint16 訪問数)
+const char TRAINING_MAGIC[4] = {'B', 'C', 'T', 'R'};
+const uint32_t TRAINING_VERSION = 1;
+const std::size_t TRAINING_FILE_HEADER_SIZE = 8;
+const std::size_t TRAINING_RECORD_FIXED_SIZE = 27 + 1 + 4 + 2;
+
+/// 局面のコンパクト表現。pieces は occupancy の LSB 順に 1 駒 4 ビット（下位ニブルが先）:
+/// 駒種 1-6、白は +0、黒は +8
+struct PackedPosition {
+    U64 occupancy = 0;
+    uint8_t pieces[16] = {0};
+    uint8_t flags = 0;          // bit0=白番, bit1-4=キャスリング権（Board と同じ並び）
+    int8_t epSquare = -1;
+    uint8_t halfMoveClock = 0;  // 255 で飽和
+};
+
+/// 学習データ 1 局面分
+struct TrainingRecord {
+    PackedPosition position;
+    int8_t result = 0;      // 最終結果（この局面の手番側から見て 1=勝ち, 0=引き分け, -1=負け）
+    float rootValue = 0.0f; // 探索後の MCTSResult::rootValue
+    std::vector<std::pair<uint16_t, uint16_t>> policy;  // (MoveToPolicyIndex, 訪問数。65535 で飽和。Gumbel 探索では改善方策 × 65535)
+};
+
+PackedPosition PackPosition(const Board& board);
+/// PackedPosition を FEN に戻す（手数は 1 固定）
+std::string PackedPositionToFen(const PackedPosition& pos);
+
+/// レコードを out の末尾に直列化
+void SerializeRecord(const TrainingRecord& rec, std::string& out);
+/// data[offset..size) から 1 レコード読み、offset を次のレコード先頭へ進める。壊れていれば false
+bool ParseRecord(const uint8_t* data, std::size_t size, std::size_t& offset, TrainingRecord& rec);
+
+/// 学習レコードをバックグラウンドスレッドでファイルに追記する。ファイルが空ならヘッダを書く。
+/// 書き込みに失敗したら（ディスクの空き不足・I/O エラー）以後のレコードは捨て、次の Write か Close が例外で知らせる。
+class TrainingDataWriter {
+public:
+    explicit TrainingDataWriter(const std::string& path);
+    ~TrainingDataWriter();
+    TrainingDataWriter(const TrainingDataWriter&) = delete;
+    TrainingDataWriter& operator=(const TrainingDataWriter&) = delete;
+
+    /// 直列化してキューに積む（書き込みは別スレッド）。既に書き込みに失敗していれば std::runtime_error
+    void Write(const std::vector<TrainingRecord>& records);
+    /// キューを書き切ってファイルを閉じる。以後の Write は無視される。
+    /// 書き込み・フラッシュ・クローズのどれかに失敗していれば std::runtime_error（最初に閉じた呼び出しだけが投げる）
+    void Close();
+    /// ファイルへの書き込みが成功したレコード数（キューに積んだだけのものは含まない）
+    long RecordsWritten() const;
+
+private:
+    void run();
+
+    std::ofstream out_;
+    std::thread thread_;
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<std::pair<std::string, long>> queue_;  // 直列化したレコードとその件数
+    bool closing_ = false;
+    bool failed_ = false;
+    long recordsWritten_ = 0;
+    std::string path_;
+};
+
+class ThreadPool;
+
+/// 1 つ以上の学習データファイルを mmap し、ミニバッチをスレッドプールで並列にデコードする。
+/// ファイル全体を読み込まず、レコード開始位置の索引だけをメモリに持つ。
+class TrainingDataReader {
+public:
+    /// numThreads<=0 ならハードウェアスレッド数。ヘッダ不一致のファイルは例外、末尾の壊れたレコードは無視する
+    TrainingDataReader(const std::vector<std::string>& paths, int numThreads = 0, unsigned int seed = 0);
+    ~TrainingDataReader();
+    TrainingDataReader(const TrainingDataReader&) = delete;
+    TrainingDataReader& operator=(const TrainingDataReader&) = delete;
+
+    std::size_t Size() const { return index_.size(); }
+    TrainingRecord Record(std::size_t i) const;
+
+    /// indices[0..n) のレコードをデコードする。出力は呼び出し側が確保した配列:
+    ///   planes[n * INPUT_SIZE]（encoding.hpp）, policy[n * POLICY_SIZE]（訪問数を合計 1 に正規化）,
+    ///   values[n]（手番側から見た result）, rootValues[n]（nullptr なら書かない）
+    void Fill(const std::size_t* indices, std::size_t n, float* planes, float* policy, float* values,
+              float* rootValues = nullptr);
+    /// シャッフル済みの順序から次の n 件を Fill する。1 周したら並べ直してエポックを進める
+    void NextBatch(std::size_t n, float* planes, float* policy, float* values, float* rootValues = nullptr);
+    long Epoch() const { return epoch_; }
+
+private:
+    struct MappedFile {
+        const uint8_t* data = nullptr;
+        std::size_t size = 0;
+    };
+    struct RecordRef {
+        uint32_t file;
+        uint64_t offset;
+    };
+
+    void decode(std::size_t index, float* planes, float* policy, float* value, float* rootValue) const;
+
+    std::vector<MappedFile> files_;
+    std::vector<RecordRef> index_;
+    std::unique_ptr<ThreadPool> pool_;
+    std::mt19937 gen_;
+    std::vector<std::size_t> order_;
+    std::size_t cursor_ = 0;
+    long epoch_ = 0;
+};
+
+#endif
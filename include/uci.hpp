@@ -0,0 +1,75 @@
+#ifndef UCI_HPP
+#define UCI_HPP
+
+#include "board.hpp"
+#include "mcts.hpp"
+#include "mcts_tree.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <iosfwd>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+
+/// UCI プロトコルのエンジン側。探索は MCTSTree で別スレッドに走らせ、
+/// 局面が進んでも前回の木の 2 手先の部分木を再利用する。go ponder 中は相手の持ち時間で探索を続け、
+/// ponderhit で同じ木のまま持ち時間の探索に切り替える。
+class UCIEngine {
+public:
+    UCIEngine(std::istream& in, std::ostream& out);
+    ~UCIEngine();
+    UCIEngine(const UCIEngine&) = delete;
+    UCIEngine& operator=(const UCIEngine&) = delete;
+
+    /// quit か入力の終わりまでコマンドを処理する
+    void Run();
+    /// 1 行処理する。quit なら false
+    bool Handle(const std::string& line);
+
+private:
+    struct GoParams {
+        int nodes = 0;               // 0 なら無制限
+        double movetimeMs = 0.0;
+        double wtimeMs = -1.0, btimeMs = -1.0, wincMs = 0.0, bincMs = 0.0;
+        int movestogo = 0;
+        int depth = 0;               // 0 なら指定なし。MCTS に深さはないのでノード数の予算に置き換える
+        int mate = 0;                // 0 なら指定なし。depth と同じくノード数の予算にし、確定したら止まる
+        bool infinite = false;
+        bool ponder = false;
+    };
+
+    void uci();
+    void setOption(std::istringstream& args);
+    void position(std::istringstream& args);
+    void go(std::istringstream& args);
+    /// 探索スレッドを止めて合流する（bestmove は探索スレッドが出力する）
+    void stopSearch();
+    void search(GoParams params);
+    /// 持ち時間から今回の探索時間（ミリ秒）を決める。制限なしなら 0
+    double timeBudgetMs(const GoParams& params, bool whiteToMove) const;
+    /// 現在の木の読み筋・ノード数・評価を info 行で出す。探索中は時間を区切って定期的に呼ぶ
+    void sendInfo(const MCTSResult& res, int simulations, double elapsedMs);
+    void send(const std::string& line);
+
+    std::istream& in_;
+    std::ostream& out_;
+    std::mutex outMutex_;
+
+    Board board_;
+    MCTSTree tree_;
+    std::mt19937 gen_;
+    bool useStaticEval_ = true;
+    double moveOverheadMs_ = 50.0;
+    int hashMb_ = 256;  // 探索木のメモリ上限（MiB）
+
+    std::thread thread_;
+    std::atomic<bool> stopFlag_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    bool stopRequested_ = false;
+    bool ponderhit_ = false;
+};
+
+#endif
@@ -2,6 +2,7 @@
 #define ZOBRIST_HPP
 
 #include "bitboard.hpp"
+#include <mutex>
 
 /// Zobrist ハッシュ用テーブル（千日手検出用に駒・手番・キャスリング権・アンパッサンを含む）
 class Zobrist {
@@ -18,7 +19,7 @@ private:
     static U64 sideKey;
     static U64 castlingKeys[4];
     static U64 epKeys[16];
-    static bool initialized;
+    static std::once_flag initFlag;
 };
 
 #endif
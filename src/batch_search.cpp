@@ -0,0 +1,420 @@
+#include "batch_search.hpp"
+#include "encoding.hpp"
+#include "eval_cache.hpp"
+#include "mcts_detail.hpp"
+#include "movegen.hpp"
+#include "tracer.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace mcts_detail {
+
+namespace {
+    /// leaf からルート直下までの仮想損失を 1 つずつ取り消す
+    void removeVirtualLoss(MCTSNode* leaf) {
+        for (MCTSNode* p = leaf; p != nullptr && p->parent != nullptr; p = p->parent)
+            p->N_virtual = std::max(0, p->N_virtual - 1);
+    }
+
+    /// sources[ci] = (バッチ, バッチ内の fens 添字) の局面を連結して batch_array_fn を呼び、合法手の prior を取り出す
+    void evaluateArrays(const std::vector<EvalBatch*>& batches,
+                        const std::vector<std::pair<std::size_t, std::size_t>>& sources, const MCTSOptions& options,
+                        std::vector<std::vector<double>>& priorResults, std::vector<double>& values) {
+        ArrayBuffers& buf = batches.front()->arrays;
+        const std::size_t n = sources.size();
+        buf.planes.resize(n * INPUT_SIZE);
+        buf.moveIndices.clear();
+        buf.moveOffsets.assign(1, 0);
+        for (std::size_t ci = 0; ci < n; ci++) {
+            const EvalBatch& batch = *batches[sources[ci].first];
+            const std::size_t fi = sources[ci].second;
+            std::copy(batch.planes.begin() + static_cast<std::ptrdiff_t>(fi * INPUT_SIZE),
+                      batch.planes.begin() + static_cast<std::ptrdiff_t>((fi + 1) * INPUT_SIZE),
+                      buf.planes.begin() + static_cast<std::ptrdiff_t>(ci * INPUT_SIZE));
+            const std::vector<int32_t>& idx = batch.moveIndices[fi];
+            buf.moveIndices.insert(buf.moveIndices.end(), idx.begin(), idx.end());
+            buf.moveOffsets.push_back(static_cast<int32_t>(buf.moveIndices.size()));
+        }
+        buf.priors.assign(n * POLICY_SIZE, 0.0f);
+        buf.values.assign(n, 0.0f);
+
+        BatchEvalArrays arrays;
+        arrays.n = n;
+        arrays.planes = buf.planes.data();
+        arrays.moveIndices = buf.moveIndices.data();
+        arrays.moveOffsets = buf.moveOffsets.data();
+        arrays.priors = buf.priors.data();
+        arrays.values = buf.values.data();
+        {
+            TraceSpan span(options.tracer, "callback");
+            options.batch_array_fn(arrays);
+        }
+
+        priorResults.assign(n, std::vector<double>());
+        values.assign(buf.values.begin(), buf.values.end());
+        for (std::size_t ci = 0; ci < n; ci++) {
+            const float* row = buf.priors.data() + ci * POLICY_SIZE;
+            for (int32_t k = buf.moveOffsets[ci]; k < buf.moveOffsets[ci + 1]; k++)
+                priorResults[ci].push_back(row[buf.moveIndices[static_cast<std::size_t>(k)]]);
+        }
+    }
+}
+
+void EvalBatch::Clear() {
+    fens.clear();
+    uci.clear();
+    planes.clear();
+    moveIndices.clear();
+    entries.clear();
+    entryToFen.clear();
+    hashes.clear();
+    toMove.clear();
+    priors.clear();
+    values.clear();
+    fenToEntry.clear();
+    evalMs = 0.0;
+}
+
+void evaluateBatch(EvalBatch& batch, const MCTSOptions& options) {
+    std::vector<EvalBatch*> batches{&batch};
+    evaluateBatches(batches, options);
+}
+
+void evaluateBatches(const std::vector<EvalBatch*>& batches, const MCTSOptions& options) {
+    // 各バッチの fens を初出順に連結する。木をまたいだ同一 FEN は 1 回だけ評価器に渡す
+    std::vector<std::string> fens;
+    std::vector<std::vector<std::string>> uci;
+    std::vector<std::vector<std::size_t>> fenIndex(batches.size());
+    std::vector<std::pair<std::size_t, std::size_t>> sources;  // 連結後の添字 -> (バッチ, バッチ内の添字)
+    std::unordered_map<std::string, std::size_t> fenToCombined;
+    for (std::size_t bi = 0; bi < batches.size(); bi++) {
+        EvalBatch& batch = *batches[bi];
+        fenIndex[bi].resize(batch.fens.size());
+        for (std::size_t fi = 0; fi < batch.fens.size(); fi++) {
+            auto ins = fenToCombined.emplace(batch.fens[fi], fens.size());
+            if (ins.second) {
+                fens.push_back(batch.fens[fi]);
+                sources.push_back({bi, fi});
+                if (!options.batch_array_fn) uci.push_back(batch.uci[fi]);
+            }
+            fenIndex[bi][fi] = ins.first->second;
+        }
+    }
+    if (fens.empty()) return;
+
+    std::vector<std::vector<double>> priorResults;
+    std::vector<double> values;
+    if (options.batch_array_fn) {
+        evaluateArrays(batches, sources, options, priorResults, values);
+    } else if (options.batch_eval_fn) {
+        BatchEvalResult evalResult;
+        {
+            TraceSpan span(options.tracer, "callback");
+            evalResult = options.batch_eval_fn(fens, uci);
+        }
+        priorResults = std::move(evalResult.priors);
+        values = std::move(evalResult.values);
+    } else {
+        TraceSpan span(options.tracer, "callback");
+        priorResults = options.batch_prior_fn(fens, uci);
+        values = options.batch_value_fn(fens);
+    }
+    if (priorResults.size() != fens.size()) priorResults.clear();
+    if (values.size() != fens.size()) values.assign(fens.size(), 0.0);
+
+    const std::vector<double> none;
+    for (std::size_t bi = 0; bi < batches.size(); bi++) {
+        EvalBatch& batch = *batches[bi];
+        for (std::size_t ei = 0; ei < batch.entries.size(); ei++) {
+            if (batch.entryToFen[ei] < 0) continue;
+            const std::size_t ci = fenIndex[bi][static_cast<std::size_t>(batch.entryToFen[ei])];
+            const std::vector<double>& priors = (ci < priorResults.size()) ? priorResults[ci] : none;
+            const std::vector<Move>& moves = batch.entries[ei].front().second.second;
+            batch.priors[ei] = normalizePriors(priors, moves.size());
+            batch.values[ei] = values[ci];
+        }
+    }
+}
+
+BatchSearch::BatchSearch(const Board& rootBoard, int numWorkers, std::mt19937& gen, const MCTSOptions& options)
+    : rootBoard_(rootBoard), gen_(gen), options_(options), rootWhite_(rootBoard.GetWhiteToMove()) {
+    root_ = new MCTSNode();
+    root_->parent = nullptr;
+    root_->N = 0;
+    root_->W = 0.0;
+    root_->P = 0.0;
+    workers_.resize(static_cast<std::size_t>(std::max(1, numWorkers)));
+    for (Worker& w : workers_) {
+        w.board = rootBoard_;
+        w.node = root_;
+        w.state = RUN;
+    }
+}
+
+BatchSearch::~BatchSearch() {
+    deleteTree(root_);
+}
+
+std::size_t BatchSearch::CountState(WorkerState s) const {
+    std::size_t n = 0;
+    for (const Worker& w : workers_)
+        if (w.state == s) n++;
+    return n;
+}
+
+void BatchSearch::Advance() {
+    MCTSStats& st = stats_.stats;
+    StatsClock clock(options_.collect_stats);
+    for (Worker& w : workers_) {
+        if (w.state != RUN) continue;
+        if (w.node->proven != GameResult::Ongoing) {
+            // 終局・確定済み: 評価し直さず確定値をバックアップしてルートへ戻す
+            clock.Lap(st.selectMs);
+            backupProven(w);
+            clock.Lap(st.backupMs);
+            continue;
+        }
+        if (w.node->children.empty()) {
+            if (w.node->pending) {
+                // 衝突: 経路の仮想訪問は残して他のワーカーをこの経路から遠ざけ、自分はルートからやり直す
+                totalCollisions_++;
+                collisionLeaves_.push_back(w.node);
+                w.board = rootBoard_;
+                w.node = root_;
+                w.depth = 0;
+                w.state = (static_cast<int>(collisionLeaves_.size()) > options_.max_collisions) ? COLLIDED : RUN;
+                continue;
+            }
+            clock.Lap(st.selectMs);
+            MoveGen::GenerateLegalMoves(w.board, w.moves);
+            if (w.moves.empty())
+                markTerminal(w.node, w.board, options_);
+            else if (probeBitbase(w.node, w.board, options_))
+                st.bitbaseHits++;
+            clock.Lap(st.expandMs);
+            if (w.node->proven != GameResult::Ongoing) {
+                backupProven(w);
+                clock.Lap(st.backupMs);
+                continue;
+            }
+            w.node->pending = true;
+            w.state = NEED_EVAL;
+            continue;
+        }
+        descend(w);
+    }
+    clock.Lap(st.selectMs);
+}
+
+std::size_t BatchSearch::Gather(EvalBatch& batch, std::size_t maxWorkers) {
+    TraceSpan gatherSpan(options_.tracer, "gather");
+    StatsClock clock(options_.collect_stats);
+    EvalCache* cache = options_.eval_cache;
+    std::size_t taken = 0;
+    for (std::size_t i = 0; i < workers_.size() && taken < maxWorkers; i++) {
+        Worker& w = workers_[i];
+        if (w.state != NEED_EVAL) continue;
+        TraceSpan encodeSpan(options_.tracer, "fen_encode");
+        const std::string fen = w.board.GetFen();
+        auto ins = batch.fenToEntry.emplace(fen, batch.entries.size());
+        if (ins.second) {
+            const U64 hash = w.board.GetZobristHash();
+            batch.entries.emplace_back();
+            batch.hashes.push_back(hash);
+            batch.toMove.push_back(w.board.GetWhiteToMove() == rootWhite_ ? 1.0 : -1.0);
+            batch.priors.emplace_back();
+            batch.values.push_back(0.0);
+            if (cache && cache->Lookup(hash, w.moves, batch.priors.back(), batch.values.back())) {
+                batch.values.back() *= batch.toMove.back();
+                batch.entryToFen.push_back(-1);
+                stats_.stats.cacheHits++;
+            } else {
+                batch.entryToFen.push_back(static_cast<long>(batch.fens.size()));
+                batch.fens.push_back(fen);
+                if (options_.batch_array_fn) {
+                    batch.planes.resize(batch.fens.size() * INPUT_SIZE);
+                    EncodeBoard(w.board, batch.planes.data() + (batch.fens.size() - 1) * INPUT_SIZE);
+                    batch.moveIndices.emplace_back();
+                    batch.moveIndices.back().reserve(w.moves.size());
+                    for (const Move& m : w.moves) batch.moveIndices.back().push_back(MoveToPolicyIndex(m));
+                } else {
+                    batch.uci.push_back(movesToUci(w.moves));
+                }
+            }
+        } else {
+            stats_.stats.dedupHits++;
+        }
+        batch.entries[ins.first->second].push_back({i, {w.node, w.moves}});
+        w.state = IN_FLIGHT;
+        taken++;
+    }
+    clock.Lap(batch.evalMs);
+    return taken;
+}
+
+void BatchSearch::Integrate(EvalBatch& batch, int remaining) {
+    MCTSStats& st = stats_.stats;
+    StatsClock clock(options_.collect_stats);
+    Tracer* tracer = options_.tracer;
+    double traceStart = tracer ? tracer->Now() : 0.0;
+    if (!batch.fens.empty()) stats_.EvalCall(batch.fens.size());
+    st.evalMs += batch.evalMs;
+    EvalCache* cache = options_.eval_cache;
+    for (std::size_t ei = 0; ei < batch.entries.size(); ei++) {
+        if (cache && batch.entryToFen[ei] >= 0)
+            cache->Insert(batch.hashes[ei], batch.entries[ei].front().second.second, batch.priors[ei],
+                          batch.values[ei] * batch.toMove[ei]);
+        std::vector<double>& p = batch.priors[ei];
+        for (const auto& e : batch.entries[ei]) {
+            MCTSNode* node = e.second.first;
+            node->pending = false;
+            // 同じリーフが先に別バッチで展開済みなら二重に子を作らない
+            if (!node->children.empty()) continue;
+            if (node->parent == nullptr && options_.dirichlet_alpha > 0.0 && !options_.gumbel)
+                applyDirichletToPriors(p, options_.dirichlet_alpha, options_.dirichlet_epsilon, gen_);
+            const std::vector<Move>& mov = e.second.second;
+            node->children.reserve(mov.size());
+            for (std::size_t i = 0; i < mov.size(); i++) {
+                MCTSNode* c = new MCTSNode();
+                c->move_from_parent = mov[i];
+                c->parent = node;
+                c->N = 0;
+                c->W = 0.0;
+                c->P = p[i];
+                node->children.push_back(c);
+            }
+            nodeCount_ += static_cast<long>(mov.size());
+            st.nodesCreated += static_cast<long>(mov.size());
+        }
+    }
+    clock.Lap(st.expandMs);
+    if (tracer) {
+        const double now = tracer->Now();
+        tracer->Record("expand", traceStart, now);
+        traceStart = now;
+    }
+
+    for (std::size_t ei = 0; ei < batch.entries.size(); ei++) {
+        const double value = batch.values[ei];
+        for (const auto& e : batch.entries[ei]) {
+            Worker& w = workers_[e.first];
+            if (remaining <= 0) {
+                resetWorker(w);
+                continue;
+            }
+            backup(e.second.first, value);
+            stats_.Simulation(w.depth);
+            completed_++;
+            remaining--;
+            w.state = RUN;
+            // Gumbel のルート探索では毎回ルートの子を配分どおりに選ぶため、ルートからやり直す
+            if (options_.gumbel) {
+                w.board = rootBoard_;
+                w.node = root_;
+                w.depth = 0;
+            }
+            descend(w);
+        }
+    }
+    releaseCollisions();
+    clock.Lap(st.backupMs);
+    if (tracer) tracer->Record("backup", traceStart, tracer->Now());
+}
+
+MCTSResult BatchSearch::Result() const {
+    MCTSResult out;
+    out.rootVisits = root_->N;
+    out.rootValue = (root_->N > 0) ? (root_->W / root_->N) : 0.0;
+    for (MCTSNode* c : root_->children) {
+        out.visits.push_back({c->move_from_parent, c->N});
+        out.priors.push_back(c->P);
+        out.moveValues.push_back(c->N > 0 ? c->W / c->N : 0.0);
+    }
+    gumbel_.Fill(root_, out);
+    fillProven(root_, out);
+    out.stats = stats_.Finish();
+    out.stats.collisions = totalCollisions_;
+    out.stats.treeBytes = MCTSTreeBytes(nodeCount_);
+    return out;
+}
+
+void BatchSearch::backup(MCTSNode* leaf, double value) {
+    double sign = 1.0;
+    for (MCTSNode* p = leaf; p != nullptr; p = p->parent) {
+        p->N++;
+        p->W += sign * value;
+        if (p->parent != nullptr) p->N_virtual = std::max(0, p->N_virtual - 1);
+        sign = -sign;
+    }
+}
+
+void BatchSearch::EnforceMemoryLimit() {
+    if (options_.memory_limit_bytes == 0 || MCTSTreeBytes(nodeCount_) <= options_.memory_limit_bytes) return;
+    // 評価待ち・衝突中でないワーカーは、刈られるかもしれないノードを指しているのでルートへ戻す
+    releaseCollisions();
+    for (Worker& w : workers_)
+        if (w.state == RUN) resetWorker(w);
+    stats_.stats.nodesPruned += enforceMemoryLimit(root_, nodeCount_, options_);
+}
+
+/// 探索を破棄したワーカーの仮想損失を取り消してルートへ戻す
+void BatchSearch::resetWorker(Worker& w) {
+    removeVirtualLoss(w.node);
+    w.board = rootBoard_;
+    w.node = root_;
+    w.depth = 0;
+    w.state = RUN;
+}
+
+/// 確定ノードに着いたワーカーの確定値をバックアップしてルートへ戻す。予算を使い切っていれば数えずに仮想損失だけ戻す
+void BatchSearch::backupProven(Worker& w) {
+    if (budget_ > 0 && completed_ >= budget_) {
+        resetWorker(w);
+        return;
+    }
+    backup(w.node, resultToValue(w.node->proven, rootWhite_));
+    stats_.Simulation(w.depth);
+    completed_++;
+    w.board = rootBoard_;
+    w.node = root_;
+    w.depth = 0;
+    w.state = RUN;
+}
+
+/// 衝突経路に残した仮想訪問を取り消し、待機中のワーカーを再開させる
+void BatchSearch::releaseCollisions() {
+    for (MCTSNode* leaf : collisionLeaves_) removeVirtualLoss(leaf);
+    collisionLeaves_.clear();
+    for (Worker& w : workers_)
+        if (w.state == COLLIDED) w.state = RUN;
+}
+
+/// 仮想損失込みの PUCT で子を 1 つ選んで進める。Gumbel のルート探索ではルートの子を逐次半減の配分で選ぶ
+void BatchSearch::descend(Worker& w) {
+    const double c_puct = options_.c_puct;
+    int parentN = w.node->N;
+    MCTSNode* best = nullptr;
+    double bestScore = -1e99;
+    const bool whiteToMove = w.board.GetWhiteToMove();
+    if (options_.gumbel && w.node == root_) {
+        if (!gumbel_.Initialized()) gumbel_.Init(root_, budget_ - completed_, options_, gen_);
+        best = gumbel_.Next(root_, whiteToMove, options_.solver);
+    }
+    if (best == nullptr) {
+        for (MCTSNode* c : w.node->children) {
+            if (options_.solver && isProvenLoss(c, whiteToMove)) continue;
+            double denom = 1.0 + c->N + c->N_virtual;
+            double score = c_puct * c->P * std::sqrt(static_cast<double>(parentN + 1)) / denom;
+            if (c->N > 0) score += c->W / c->N;
+            else if (options_.pfu_scale > 0.0) score += getPfuInitialValue(w.node, c, options_.pfu_scale);
+            if (score > bestScore) { bestScore = score; best = c; }
+        }
+    }
+    if (!best) return;
+    best->N_virtual += 1;
+    w.board.MakeMove(best->move_from_parent);
+    w.node = best;
+    w.depth++;
+}
+
+}
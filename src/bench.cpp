@@ -0,0 +1,272 @@
+// ベンチマーク: 固定局面で各処理のスループットを測り、JSON を標準出力に書く。
+//   ./chess_bench [--reps N] [--warmup N] [--scale X]
+// signature は perft ノード数と固定シードの MCTS 訪問分布から作る値で、探索の挙動が変わると変わる。
+
+#include "board.hpp"
+#include "mcts.hpp"
+#include "movegen.hpp"
+#include "move.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+    const char* BENCH_FENS[] = {
+        "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+        "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+        "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+        "r2q1rk1/pP1p2pp/Q4n2/bbp1p3/Np6/1B3NBn/pPPP1PPP/R3K2R b KQ - 0 1",
+        "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+        "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+    };
+
+    struct Options {
+        int reps = 5;
+        int warmup = 1;
+        double scale = 1.0;  // 各計測の作業量の倍率
+    };
+
+    struct Measurement {
+        std::string name;
+        std::string unit;
+        std::vector<double> rates;
+    };
+
+    std::vector<Board> benchBoards() {
+        std::vector<Board> boards;
+        for (const char* fen : BENCH_FENS) {
+            Board b;
+            b.SetFromFen(fen);
+            boards.push_back(b);
+        }
+        return boards;
+    }
+
+    /// work() は処理した単位数を返す。warmup 回捨ててから reps 回の 単位数/秒 を集める
+    Measurement measure(const std::string& name, const std::string& unit, const Options& opts,
+                        const std::function<double()>& work) {
+        Measurement m;
+        m.name = name;
+        m.unit = unit;
+        for (int i = 0; i < opts.warmup; i++) work();
+        for (int i = 0; i < opts.reps; i++) {
+            const auto start = std::chrono::steady_clock::now();
+            const double units = work();
+            const double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            m.rates.push_back(sec > 0.0 ? units / sec : 0.0);
+        }
+        std::cerr << name << ": " << static_cast<long>(m.rates.empty() ? 0.0 : m.rates.back()) << " " << unit << std::endl;
+        return m;
+    }
+
+    int scaled(int n, const Options& opts) {
+        return std::max(1, static_cast<int>(n * opts.scale));
+    }
+
+    uint64_t perft(Board& board, int depth) {
+        std::vector<Move> moves;
+        MoveGen::GenerateLegalMoves(board, moves);
+        if (depth <= 1) return moves.size();
+        uint64_t nodes = 0;
+        for (const Move& m : moves) {
+            board.MakeMove(m);
+            nodes += perft(board, depth - 1);
+            board.UnmakeMove(m);
+        }
+        return nodes;
+    }
+
+    /// FNV-1a で 64 ビット値を混ぜる
+    void mix(uint64_t& h, uint64_t v) {
+        for (int i = 0; i < 8; i++) {
+            h ^= (v >> (i * 8)) & 0xFF;
+            h *= 1099511628211ULL;
+        }
+    }
+
+    /// perft(3) の合計と、固定シード・固定反復数の MCTS（逐次・バッチ）の訪問分布から作る挙動の署名
+    uint64_t signature(const std::vector<Board>& boards, uint64_t& perftNodes) {
+        uint64_t h = 1469598103934665603ULL;
+        perftNodes = 0;
+        for (const Board& b : boards) {
+            Board copy = b;
+            const uint64_t n = perft(copy, 3);
+            perftNodes += n;
+            mix(h, n);
+        }
+        // MCTS-solver を含めた探索の挙動を見る（既定は無効）
+        MCTSOptions serial;
+        serial.static_eval = true;
+        serial.solver = true;
+        MCTSOptions batch;
+        batch.batch_size = 16;
+        batch.solver = true;
+        batch.batch_eval_fn = [](const std::vector<std::string>& fens, const std::vector<std::vector<std::string>>&) {
+            BatchEvalResult r;
+            r.values.assign(fens.size(), 0.0);
+            return r;
+        };
+        for (std::size_t i = 0; i < boards.size(); i++) {
+            for (const MCTSOptions* o : {&serial, &batch}) {
+                std::mt19937 gen(static_cast<unsigned int>(1000 + i));
+                const MCTSResult res = RunMCTS(boards[i], 400, gen, *o);
+                for (const auto& p : res.visits) {
+                    mix(h, PackMove(p.first));
+                    mix(h, static_cast<uint64_t>(p.second));
+                }
+            }
+        }
+        return h;
+    }
+
+    double median(std::vector<double> v) {
+        if (v.empty()) return 0.0;
+        std::sort(v.begin(), v.end());
+        const std::size_t n = v.size();
+        return (n % 2 == 1) ? v[n / 2] : 0.5 * (v[n / 2 - 1] + v[n / 2]);
+    }
+
+    std::string number(double x) {
+        char buf[64];
+        std::snprintf(buf, sizeof(buf), "%.1f", x);
+        return buf;
+    }
+
+    std::string toJson(const std::vector<Measurement>& ms, const Options& opts, uint64_t sig, uint64_t perftNodes) {
+        std::ostringstream out;
+        out << "{\n  \"reps\": " << opts.reps << ",\n  \"warmup\": " << opts.warmup << ",\n  \"scale\": " << opts.scale
+            << ",\n  \"positions\": " << (sizeof(BENCH_FENS) / sizeof(BENCH_FENS[0]))
+            << ",\n  \"perft_nodes\": " << perftNodes << ",\n  \"signature\": \"" << std::hex << sig << std::dec
+            << "\",\n  \"benchmarks\": [\n";
+        for (std::size_t i = 0; i < ms.size(); i++) {
+            const Measurement& m = ms[i];
+            out << "    {\"name\": \"" << m.name << "\", \"unit\": \"" << m.unit << "\", \"median\": " << number(median(m.rates))
+                << ", \"min\": " << number(*std::min_element(m.rates.begin(), m.rates.end()))
+                << ", \"max\": " << number(*std::max_element(m.rates.begin(), m.rates.end())) << ", \"samples\": [";
+            for (std::size_t k = 0; k < m.rates.size(); k++) out << (k ? ", " : "") << number(m.rates[k]);
+            out << "]}" << (i + 1 < ms.size() ? "," : "") << "\n";
+        }
+        out << "  ]\n}\n";
+        return out.str();
+    }
+
+    Options parseArgs(int argc, char** argv) {
+        Options opts;
+        for (int i = 1; i < argc; i++) {
+            const std::string arg = argv[i];
+            const bool hasValue = i + 1 < argc;
+            if (arg == "--reps" && hasValue) opts.reps = std::max(1, std::atoi(argv[++i]));
+            else if (arg == "--warmup" && hasValue) opts.warmup = std::max(0, std::atoi(argv[++i]));
+            else if (arg == "--scale" && hasValue) opts.scale = std::max(0.01, std::atof(argv[++i]));
+            else {
+                std::cerr << "usage: " << argv[0] << " [--reps N] [--warmup N] [--scale X]" << std::endl;
+                std::exit(2);
+            }
+        }
+        return opts;
+    }
+}
+
+int main(int argc, char** argv) {
+    const Options opts = parseArgs(argc, argv);
+    MoveGen::Init();
+    std::vector<Board> boards = benchBoards();
+    std::vector<Measurement> results;
+    // 計測対象の結果を捨てられないようにする
+    volatile uint64_t sink = 0;
+
+    results.push_back(measure("movegen", "calls/s", opts, [&]() {
+        const int loops = scaled(20000, opts);
+        std::vector<Move> moves;
+        for (int i = 0; i < loops; i++) {
+            for (Board& b : boards) {
+                MoveGen::GenerateLegalMoves(b, moves);
+                sink = sink + moves.size();
+            }
+        }
+        return static_cast<double>(loops) * boards.size();
+    }));
+
+    results.push_back(measure("make_unmake", "pairs/s", opts, [&]() {
+        const int loops = scaled(20000, opts);
+        double pairs = 0.0;
+        for (const Board& b0 : boards) {
+            Board b = b0;
+            std::vector<Move> moves;
+            MoveGen::GenerateLegalMoves(b, moves);
+            for (int i = 0; i < loops; i++) {
+                for (const Move& m : moves) {
+                    b.MakeMove(m);
+                    b.UnmakeMove(m);
+                }
+            }
+            pairs += static_cast<double>(loops) * moves.size();
+        }
+        return pairs;
+    }));
+
+    results.push_back(measure("random_playout", "playouts/s", opts, [&]() {
+        const int loops = scaled(100, opts);
+        std::mt19937 gen(42);
+        for (int i = 0; i < loops; i++)
+            for (const Board& b : boards) MoveGen::DoRandomPlayout(b, gen);
+        return static_cast<double>(loops) * boards.size();
+    }));
+
+    results.push_back(measure("mcts_serial", "simulations/s", opts, [&]() {
+        // 木の操作の速さを見るため、評価は組み込み静的評価（プレイアウトの速さは random_playout で測る）
+        const int iterations = scaled(5000, opts);
+        MCTSOptions o;
+        o.static_eval = true;
+        double sims = 0.0;
+        for (std::size_t i = 0; i < boards.size(); i++) {
+            std::mt19937 gen(static_cast<unsigned int>(i));
+            sims += RunMCTS(boards[i], iterations, gen, o).rootVisits;
+        }
+        return sims;
+    }));
+
+    results.push_back(measure("mcts_batch", "simulations/s", opts, [&]() {
+        const int iterations = scaled(5000, opts);
+        MCTSOptions o;
+        o.batch_size = 32;
+        o.batch_eval_fn = [](const std::vector<std::string>& fens, const std::vector<std::vector<std::string>>&) {
+            BatchEvalResult r;
+            r.values.assign(fens.size(), 0.0);
+            return r;
+        };
+        double sims = 0.0;
+        for (std::size_t i = 0; i < boards.size(); i++) {
+            std::mt19937 gen(static_cast<unsigned int>(i));
+            sims += RunMCTS(boards[i], iterations, gen, o).rootVisits;
+        }
+        return sims;
+    }));
+
+    results.push_back(measure("fen_roundtrip", "roundtrips/s", opts, [&]() {
+        const int loops = scaled(20000, opts);
+        Board b;
+        for (int i = 0; i < loops; i++) {
+            for (const Board& src : boards) {
+                b.SetFromFen(src.GetFen());
+                sink = sink + b.GetZobristHash();
+            }
+        }
+        return static_cast<double>(loops) * boards.size();
+    }));
+
+    uint64_t perftNodes = 0;
+    const uint64_t sig = signature(boards, perftNodes);
+    std::cerr << "signature: " << std::hex << sig << std::dec << " (perft " << perftNodes << ")" << std::endl;
+    std::cout << toJson(results, opts, sig, perftNodes);
+    return 0;
+}
@@ -0,0 +1,586 @@
+#include "bitbase.hpp"
+#include "movegen.hpp"
+#include "thread_pool.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+    const char PIECE_ORDER[] = "KQRBNP";
+
+    int pieceFromChar(char c) {
+        switch (c) {
+            case 'K': return KING;
+            case 'Q': return QUEEN;
+            case 'R': return ROOK;
+            case 'B': return BISHOP;
+            case 'N': return KNIGHT;
+            case 'P': return PAWN;
+            default: return NO_PIECE;
+        }
+    }
+
+    int sideValue(const std::string& side) {
+        int v = 0;
+        for (char c : side) v += (c == 'K') ? 0 : PIECE_VALUE[pieceFromChar(c)];
+        return v;
+    }
+
+    /// 片側の駒をキング・QRBNP の順に並べる
+    std::string sortSide(std::string side) {
+        std::sort(side.begin(), side.end(), [](char a, char b) {
+            return std::strchr(PIECE_ORDER, a) < std::strchr(PIECE_ORDER, b);
+        });
+        return side;
+    }
+
+    /// 両側から正規化した名前を作る。駒の価値の合計が大きい側（同じなら名前の小さい側）を前にする
+    std::string joinSides(const std::string& a, const std::string& b) {
+        const std::string sa = sortSide(a), sb = sortSide(b);
+        const int va = sideValue(sa), vb = sideValue(sb);
+        if (va != vb) return va > vb ? sa + sb : sb + sa;
+        return sa <= sb ? sa + sb : sb + sa;
+    }
+
+    void splitSides(const std::string& canonical, std::string& first, std::string& second) {
+        const std::size_t k = canonical.find('K', 1);
+        first = canonical.substr(0, k);
+        second = canonical.substr(k);
+    }
+
+    /// キングを除く駒種ごとの数（4 ビットずつ）
+    uint32_t sideSignature(const std::string& side) {
+        uint32_t sig = 0;
+        for (char c : side)
+            if (c != 'K') sig += 1u << (4 * (pieceFromChar(c) - 1));
+        return sig;
+    }
+
+    uint32_t boardSignature(const Board& board, bool white) {
+        uint32_t sig = 0;
+        for (int pt = PAWN; pt <= QUEEN; pt++)
+            sig += static_cast<uint32_t>(__builtin_popcountll(board.GetPieceBitboard(pt, white))) << (4 * (pt - 1));
+        return sig;
+    }
+
+    enum : uint8_t { UNKNOWN = 0, WIN = 1, LOSS = 2, DRAW = 3, INVALID = 4 };
+    const uint8_t CAN_DRAW = 0x80;  // remaining: 表の外へ出る手で引き分けにできる（負けにならない）
+
+    bool fileExists(const std::string& path) {
+        struct stat st;
+        return ::stat(path.c_str(), &st) == 0;
+    }
+}
+
+struct Bitbases::Table {
+    std::string material;
+    int n = 0;
+    int types[BITBASE_MAX_PIECES] = {};
+    bool white[BITBASE_MAX_PIECES] = {};
+    int groupStart[BITBASE_MAX_PIECES] = {};  // 同じ駒（同色・同種）の並びの先頭
+    uint32_t sigWhite = 0, sigBlack = 0;
+    std::vector<uint8_t> owned;
+    const uint8_t* data = nullptr;
+    void* map = nullptr;
+    std::size_t mapSize = 0;
+
+    explicit Table(const std::string& canonical) : material(canonical) {
+        std::string first, second;
+        splitSides(canonical, first, second);
+        n = static_cast<int>(canonical.size());
+        for (int k = 0; k < n; k++) {
+            types[k] = pieceFromChar(canonical[static_cast<std::size_t>(k)]);
+            white[k] = k < static_cast<int>(first.size());
+            groupStart[k] = (k > 0 && types[k] == types[k - 1] && white[k] == white[k - 1]) ? groupStart[k - 1] : k;
+        }
+        sigWhite = sideSignature(first);
+        sigBlack = sideSignature(second);
+    }
+
+    ~Table() {
+        if (map) ::munmap(map, mapSize);
+    }
+
+    std::size_t Entries() const { return std::size_t(2) << (6 * n); }
+    std::size_t Bytes() const { return (Entries() + 3) / 4; }
+
+    std::size_t Index(bool whiteToMove, const int* squares) const {
+        std::size_t idx = whiteToMove ? 0 : 1;
+        for (int k = 0; k < n; k++) idx = idx * 64 + static_cast<std::size_t>(squares[k]);
+        return idx;
+    }
+
+    void Decode(std::size_t idx, int* squares, bool& whiteToMove) const {
+        for (int k = n - 1; k >= 0; k--) {
+            squares[k] = static_cast<int>(idx & 63);
+            idx >>= 6;
+        }
+        whiteToMove = (idx == 0);
+    }
+
+    /// 同じ駒のマスを昇順に並べ直す
+    void SortGroups(int* squares) const {
+        for (int k = 1; k < n; k++) {
+            for (int j = k; j > groupStart[k] && squares[j - 1] > squares[j]; j--) std::swap(squares[j - 1], squares[j]);
+        }
+    }
+
+    int Value(std::size_t idx) const { return (data[idx >> 2] >> ((idx & 3) * 2)) & 3; }
+};
+
+Bitbases::Bitbases() {
+    MoveGen::Init();
+}
+
+Bitbases::~Bitbases() = default;
+
+std::string Bitbases::Canonical(const std::string& material) {
+    if (material.size() < 2 || static_cast<int>(material.size()) > BITBASE_MAX_PIECES || material[0] != 'K')
+        throw std::invalid_argument("bad bitbase material: " + material);
+    const std::size_t k = material.find('K', 1);
+    if (k == std::string::npos || material.find('K', k + 1) != std::string::npos)
+        throw std::invalid_argument("bad bitbase material: " + material);
+    for (char c : material)
+        if (pieceFromChar(c) == NO_PIECE) throw std::invalid_argument("bad bitbase material: " + material);
+    return joinSides(material.substr(0, k), material.substr(k));
+}
+
+const Bitbases::Table* Bitbases::find(const std::string& canonical) const {
+    for (const auto& t : tables_)
+        if (t->material == canonical) return t.get();
+    return nullptr;
+}
+
+void Bitbases::add(std::unique_ptr<Table> table) {
+    maxPieces_ = std::max(maxPieces_, table->n);
+    tables_.push_back(std::move(table));
+}
+
+namespace {
+    /// 駒を取る手・昇格で canonical から移る先の駒構成（キングだけになるものは除く）
+    std::vector<std::string> dependencies(const std::string& canonical) {
+        std::string sides[2];
+        splitSides(canonical, sides[0], sides[1]);
+        std::vector<std::string> out;
+        for (int s = 0; s < 2; s++) {
+            for (std::size_t i = 1; i < sides[s].size(); i++) {
+                std::string rest = sides[s];
+                rest.erase(i, 1);
+                if (rest.size() + sides[1 - s].size() > 2) out.push_back(joinSides(rest, sides[1 - s]));
+                if (sides[s][i] != 'P') continue;
+                for (char promo : {'Q', 'R', 'B', 'N'}) {
+                    std::string promoted = sides[s];
+                    promoted[i] = promo;
+                    out.push_back(joinSides(promoted, sides[1 - s]));
+                }
+            }
+        }
+        std::sort(out.begin(), out.end());
+        out.erase(std::unique(out.begin(), out.end()), out.end());
+        return out;
+    }
+}
+
+void Bitbases::Generate(const std::string& material) {
+    const std::string canonical = Canonical(material);
+    if (canonical.size() <= 2 || find(canonical) != nullptr) return;
+    for (const std::string& dep : dependencies(canonical)) Generate(dep);
+    build(canonical);
+}
+
+void Bitbases::LoadOrGenerate(const std::string& material, const std::string& directory) {
+    const std::string canonical = Canonical(material);
+    if (canonical.size() <= 2 || find(canonical) != nullptr) return;
+    const std::string path = directory + "/" + canonical + ".bb";
+    if (fileExists(path)) {
+        Load(path);
+        return;
+    }
+    for (const std::string& dep : dependencies(canonical)) LoadOrGenerate(dep, directory);
+    build(canonical);
+    Save(canonical, path);
+}
+
+namespace {
+    /// from にある駒（駒種 type、色 white）が盤面 occ で動けるマス（味方の駒を除く前）。ポーンは前進と斜めの利き
+    U64 moveTargets(int type, int from, bool white, U64 occ) {
+        const Square sq = static_cast<Square>(from);
+        switch (type) {
+            case KING: return MoveGen::GetKingMoves(sq);
+            case KNIGHT: return MoveGen::GetKnightMoves(sq);
+            case BISHOP: return MoveGen::GetBishopMoves(sq, occ);
+            case ROOK: return MoveGen::GetRookMoves(sq, occ);
+            case QUEEN: return MoveGen::GetQueenMoves(sq, occ);
+            case PAWN: {
+                // 斜めは相手の駒があるときだけ。味方の駒は呼び出し側で除く
+                U64 targets = MoveGen::GetPawnCaptures(sq, white) & occ;
+                const int one = from + (white ? 8 : -8);
+                if (!(occ & (1ULL << one))) {
+                    targets |= 1ULL << one;
+                    const int two = one + (white ? 8 : -8);
+                    if ((from >> 3) == (white ? 1 : 6) && !(occ & (1ULL << two))) targets |= 1ULL << two;
+                }
+                return targets;
+            }
+            default: return 0;
+        }
+    }
+
+    /// 駒種 types・色 colors の n 駒が squares にあるとき、white 側のキングに相手の駒（skip 番目は取られたものとして除く）が利いているか
+    bool inCheck(const int* types, const bool* colors, int n, const int* squares, U64 occ, bool white, int skip) {
+        int king = 0;
+        for (int k = 0; k < n; k++)
+            if (types[k] == KING && colors[k] == white) king = squares[k];
+        for (int k = 0; k < n; k++) {
+            if (k == skip || colors[k] == white) continue;
+            const U64 attacks = types[k] == PAWN ? MoveGen::GetPawnCaptures(static_cast<Square>(squares[k]), !white)
+                                                 : moveTargets(types[k], squares[k], !white, occ);
+            if (attacks & (1ULL << king)) return true;
+        }
+        return false;
+    }
+}
+
+void Bitbases::build(const std::string& canonical) {
+    std::unique_ptr<Table> table(new Table(canonical));
+    const Table& t = *table;
+    const std::size_t entries = t.Entries();
+    std::vector<uint8_t> state(entries, UNKNOWN);
+    std::vector<uint8_t> remaining(entries, 0);  // 表の中に留まる手のうち、行き先が相手の勝ちと決まっていない数
+    // 確定したが前の局面へまだ伝えていない局面。2. は手数の順に 1 段ずつ処理し、次の段を next に集める
+    std::vector<uint32_t> frontier, next;
+
+    // squares の k 番目のポーンが 2 マス進んだ直後に相手がアンパッサンで取ったときの、取る側から見た最善の結果。
+    // 取れなければ Ongoing。表はアンパッサンのない局面なので、この手は取る手の結果を加えて扱う。board は作業用
+    auto enPassant = [&](const int* squares, int k, Board& board) {
+        const bool taker = !t.white[k];
+        const int epSq = squares[k] + (t.white[k] ? -8 : 8);
+        U64 occ = 0;
+        for (int j = 0; j < t.n; j++) occ |= 1ULL << squares[j];
+        GameResult best = GameResult::Ongoing;
+        for (int j = 0; j < t.n; j++) {
+            if (t.types[j] != PAWN || t.white[j] != taker ||
+                !(MoveGen::GetPawnCaptures(static_cast<Square>(squares[j]), taker) & (1ULL << epSq)))
+                continue;
+            int moved[BITBASE_MAX_PIECES];
+            std::copy(squares, squares + t.n, moved);
+            moved[j] = epSq;
+            const U64 after = (occ & ~(1ULL << squares[j]) & ~(1ULL << squares[k])) | (1ULL << epSq);
+            if (inCheck(t.types, t.white, t.n, moved, after, taker, k)) continue;
+            int types[BITBASE_MAX_PIECES];
+            Square sqs[BITBASE_MAX_PIECES];
+            bool white[BITBASE_MAX_PIECES];
+            int m = 0;
+            for (int i = 0; i < t.n; i++) {
+                if (i == k) continue;
+                types[m] = t.types[i];
+                sqs[m] = static_cast<Square>(moved[i]);
+                white[m] = t.white[i];
+                m++;
+            }
+            board.SetPieces(types, sqs, white, m, !taker);
+            const GameResult r = Probe(board);
+            if (r == GameResult::Ongoing) throw std::logic_error("bitbase dependency missing for " + canonical);
+            if (r == (taker ? GameResult::WhiteWin : GameResult::BlackWin)) return r;
+            if (r == GameResult::Draw || best == GameResult::Ongoing) best = r;
+        }
+        return best;
+    };
+
+    // 1. 各局面の合法手を数え、終局と、駒を取る手・昇格（表の外へ出る手）で決まる局面を確定させる。
+    //    局面ごとに独立なので、添字の範囲に分けて並列に調べる（伝播の結果は処理の順によらない）
+    ThreadPool pool;
+    std::mutex frontierMutex;
+    pool.ParallelFor(entries, [&](std::size_t begin, std::size_t end) {
+        Board board;
+        int squares[BITBASE_MAX_PIECES];
+        std::vector<uint32_t> local;
+        for (std::size_t idx = begin; idx < end; idx++) {
+            bool whiteToMove;
+            t.Decode(idx, squares, whiteToMove);
+            U64 occ = 0;
+            bool valid = true;
+            for (int k = 0; k < t.n && valid; k++) {
+                const U64 bit = 1ULL << squares[k];
+                const int rank = squares[k] >> 3;
+                if ((occ & bit) || (t.types[k] == PAWN && (rank == 0 || rank == 7)) ||
+                    (t.groupStart[k] != k && squares[k - 1] > squares[k]))
+                    valid = false;
+                occ |= bit;
+            }
+            if (!valid || inCheck(t.types, t.white, t.n, squares, occ, !whiteToMove, -1)) {
+                state[idx] = INVALID;
+                continue;
+            }
+
+            int legal = 0, inside = 0;
+            bool win = false, canDraw = false;
+            for (int k = 0; k < t.n && !win; k++) {
+                if (t.white[k] != whiteToMove) continue;
+                U64 own = 0;
+                for (int j = 0; j < t.n; j++)
+                    if (t.white[j] == whiteToMove) own |= 1ULL << squares[j];
+                const int from = squares[k];
+                for (U64 targets = moveTargets(t.types[k], from, whiteToMove, occ) & ~own; targets && !win;
+                     targets &= targets - 1) {
+                    const int to = __builtin_ctzll(targets);
+                    int captured = -1;
+                    for (int j = 0; j < t.n; j++)
+                        if (j != k && squares[j] == to) captured = j;
+                    int moved[BITBASE_MAX_PIECES];
+                    std::copy(squares, squares + t.n, moved);
+                    moved[k] = to;
+                    const U64 after = (occ & ~(1ULL << from)) | (1ULL << to);
+                    if (inCheck(t.types, t.white, t.n, moved, after, whiteToMove, captured)) continue;
+                    legal++;
+                    const bool promotion = t.types[k] == PAWN && ((to >> 3) == 0 || (to >> 3) == 7);
+                    if (captured < 0 && !promotion) {
+                        // アンパッサンで取られて負ける 2 マス前進は、行き先によらず負けの手なので数えない
+                        if (t.types[k] == PAWN && std::abs(to - from) == 16 &&
+                            enPassant(moved, k, board) == (whiteToMove ? GameResult::BlackWin : GameResult::WhiteWin))
+                            continue;
+                        inside++;
+                        continue;
+                    }
+                    for (int promo : {QUEEN, ROOK, BISHOP, KNIGHT}) {
+                        int types[BITBASE_MAX_PIECES];
+                        Square sqs[BITBASE_MAX_PIECES];
+                        bool white[BITBASE_MAX_PIECES];
+                        int m = 0;
+                        for (int j = 0; j < t.n; j++) {
+                            if (j == captured) continue;
+                            types[m] = (j == k && promotion) ? promo : t.types[j];
+                            sqs[m] = static_cast<Square>(moved[j]);
+                            white[m] = t.white[j];
+                            m++;
+                        }
+                        board.SetPieces(types, sqs, white, m, !whiteToMove);
+                        const GameResult r = Probe(board);
+                        if (r == GameResult::Ongoing) throw std::logic_error("bitbase dependency missing for " + canonical);
+                        if (r == (whiteToMove ? GameResult::WhiteWin : GameResult::BlackWin)) {
+                            win = true;
+                            break;
+                        }
+                        if (r == GameResult::Draw) canDraw = true;
+                        if (!promotion) break;
+                    }
+                }
+            }
+            if (win)
+                state[idx] = WIN;
+            else if (legal == 0)
+                state[idx] = inCheck(t.types, t.white, t.n, squares, occ, whiteToMove, -1) ? LOSS : DRAW;
+            else if (inside == 0 && !canDraw)
+                state[idx] = LOSS;
+            else
+                remaining[idx] = static_cast<uint8_t>(inside | (canDraw ? CAN_DRAW : 0));
+            if (state[idx] == WIN || state[idx] == LOSS) local.push_back(static_cast<uint32_t>(idx));
+        }
+        std::lock_guard<std::mutex> lock(frontierMutex);
+        frontier.insert(frontier.end(), local.begin(), local.end());
+    });
+
+    // 2. 確定した局面から 1 手戻した局面へ伝える。負けの局面へ指せる側は勝ち、
+    //    表の中の手が全て相手の勝ちに行き着き、外へ出る手でも引き分けにできない側は負け。
+    //    表全体を走査し直さず、新しく確定した局面だけを次の段で処理する
+    Board board;
+    int squares[BITBASE_MAX_PIECES];
+    while (!frontier.empty()) {
+        next.clear();
+        for (const uint32_t idx : frontier) {
+            const uint8_t v = state[idx];
+            bool whiteToMove;
+            t.Decode(idx, squares, whiteToMove);
+            const bool moverWhite = !whiteToMove;
+            U64 occ = 0;
+            for (int k = 0; k < t.n; k++) occ |= 1ULL << squares[k];
+            for (int k = 0; k < t.n; k++) {
+                if (t.white[k] != moverWhite) continue;
+                const Square from = static_cast<Square>(squares[k]);
+                U64 targets = 0;
+                switch (t.types[k]) {
+                    case KING: targets = MoveGen::GetKingMoves(from); break;
+                    case KNIGHT: targets = MoveGen::GetKnightMoves(from); break;
+                    case BISHOP: targets = MoveGen::GetBishopMoves(from, occ); break;
+                    case ROOK: targets = MoveGen::GetRookMoves(from, occ); break;
+                    case QUEEN: targets = MoveGen::GetQueenMoves(from, occ); break;
+                    case PAWN: {
+                        // 取らない前進を戻す。元のマスは 2 段目以降、2 マス進んだのは 4 段目（黒は 5 段目）からだけ
+                        const int dir = moverWhite ? -8 : 8;
+                        const int back = squares[k] + dir;
+                        const int backRank = back >> 3;
+                        if (!(occ & (1ULL << back)) && backRank != 0 && backRank != 7) {
+                            targets |= 1ULL << back;
+                            const int startRank = moverWhite ? 1 : 6;
+                            const int back2 = back + dir;
+                            if ((squares[k] >> 3) == startRank - 2 * (dir / 8) && !(occ & (1ULL << back2)))
+                                targets |= 1ULL << back2;
+                        }
+                        break;
+                    }
+                    default: break;
+                }
+                targets &= ~occ;
+                while (targets) {
+                    int prev[BITBASE_MAX_PIECES];
+                    std::copy(squares, squares + t.n, prev);
+                    prev[k] = __builtin_ctzll(targets);
+                    targets &= targets - 1;
+                    const bool doublePush = t.types[k] == PAWN && std::abs(prev[k] - squares[k]) == 16;
+                    t.SortGroups(prev);
+                    const std::size_t q = t.Index(moverWhite, prev);
+                    if (state[q] != UNKNOWN) continue;
+                    if (doublePush) {
+                        // アンパッサンで取られて負ける手は 1. で数えていない。取って引き分けにできるなら、行き先が負けでも勝ちにはならない
+                        const GameResult ep = enPassant(squares, k, board);
+                        if (ep == (whiteToMove ? GameResult::WhiteWin : GameResult::BlackWin)) continue;
+                        if (ep == GameResult::Draw && v == LOSS) continue;
+                    }
+                    if (v == LOSS) {
+                        state[q] = WIN;
+                        next.push_back(static_cast<uint32_t>(q));
+                    } else if (v == WIN) {
+                        const uint8_t left = static_cast<uint8_t>((remaining[q] & ~CAN_DRAW) - 1);
+                        if (left == 0 && !(remaining[q] & CAN_DRAW)) {
+                            state[q] = LOSS;
+                            next.push_back(static_cast<uint32_t>(q));
+                        } else {
+                            remaining[q] = static_cast<uint8_t>(left | (remaining[q] & CAN_DRAW));
+                        }
+                    }
+                }
+            }
+        }
+        frontier.swap(next);
+    }
+
+    // 3. 決まらなかった局面は引き分け。2 ビットに詰める
+    table->owned.assign(t.Bytes(), 0);
+    for (std::size_t idx = 0; idx < entries; idx++) {
+        const uint8_t v = state[idx];
+        if (v == WIN || v == LOSS) table->owned[idx >> 2] |= static_cast<uint8_t>(v << ((idx & 3) * 2));
+    }
+    table->data = table->owned.data();
+    add(std::move(table));
+}
+
+void Bitbases::Save(const std::string& material, const std::string& path) const {
+    const std::string canonical = Canonical(material);
+    const Table* t = find(canonical);
+    if (t == nullptr) throw std::invalid_argument("bitbase not loaded: " + canonical);
+    std::string header(BITBASE_MAGIC, 4);
+    for (int i = 0; i < 4; i++) header.push_back(static_cast<char>((BITBASE_VERSION >> (8 * i)) & 0xFF));
+    std::string name = canonical;
+    name.resize(8, '\0');
+    header += name;
+
+    const std::string tmp = path + ".tmp";
+    {
+        std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+        if (!out) throw std::runtime_error("cannot open bitbase for writing: " + tmp);
+        out.write(header.data(), static_cast<std::streamsize>(header.size()));
+        out.write(reinterpret_cast<const char*>(t->data), static_cast<std::streamsize>(t->Bytes()));
+        if (!out.flush()) throw std::runtime_error("cannot write bitbase: " + tmp);
+    }
+    if (std::rename(tmp.c_str(), path.c_str()) != 0) {
+        std::remove(tmp.c_str());
+        throw std::runtime_error("cannot rename bitbase to: " + path);
+    }
+}
+
+void Bitbases::Load(const std::string& path) {
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) throw std::runtime_error("cannot open bitbase: " + path);
+    struct stat st;
+    if (::fstat(fd, &st) != 0) {
+        ::close(fd);
+        throw std::runtime_error("cannot stat bitbase: " + path);
+    }
+    const std::size_t size = static_cast<std::size_t>(st.st_size);
+    void* p = size > 0 ? ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+    ::close(fd);
+    if (p == MAP_FAILED) throw std::runtime_error("cannot mmap bitbase: " + path);
+    const uint8_t* data = static_cast<const uint8_t*>(p);
+
+    std::unique_ptr<Table> table;
+    if (size >= BITBASE_HEADER_SIZE && std::memcmp(data, BITBASE_MAGIC, 4) == 0 &&
+        (data[4] | (data[5] << 8) | (data[6] << 16) | (static_cast<uint32_t>(data[7]) << 24)) == BITBASE_VERSION) {
+        const std::string name(reinterpret_cast<const char*>(data + 8), strnlen(reinterpret_cast<const char*>(data + 8), 8));
+        try {
+            if (Canonical(name) == name && name.size() > 2) table.reset(new Table(name));
+        } catch (const std::invalid_argument&) {
+        }
+    }
+    if (!table || size != BITBASE_HEADER_SIZE + table->Bytes()) {
+        ::munmap(p, size);
+        throw std::runtime_error("not a bitbase file: " + path);
+    }
+    table->map = p;
+    table->mapSize = size;
+    table->data = data + BITBASE_HEADER_SIZE;
+    if (find(table->material) != nullptr) return;  // 既にある表は差し替えない（table の破棄で munmap する）
+    add(std::move(table));
+}
+
+GameResult Bitbases::Probe(const Board& board) const {
+    const U64 all = board.GetAllPieces();
+    const int count = __builtin_popcountll(all);
+    if (count > maxPieces_) return GameResult::Ongoing;
+    if (board.CanWhiteKingsideCastle() || board.CanWhiteQueensideCastle() || board.CanBlackKingsideCastle() ||
+        board.CanBlackQueensideCastle())
+        return GameResult::Ongoing;
+    // 表はアンパッサンのない局面なので、実際にアンパッサンで取れるときだけ引かない
+    const int ep = board.GetEnPassantTarget();
+    if (ep >= 0 && (MoveGen::GetPawnCaptures(static_cast<Square>(ep), !board.GetWhiteToMove()) &
+                    board.GetPieceBitboard(PAWN, board.GetWhiteToMove())))
+        return GameResult::Ongoing;
+    if (count == 2) return GameResult::Draw;
+
+    const uint32_t sigW = boardSignature(board, true), sigB = boardSignature(board, false);
+    const Table* t = nullptr;
+    bool flip = false;
+    for (const auto& tab : tables_) {
+        if (tab->sigWhite == sigW && tab->sigBlack == sigB) {
+            t = tab.get();
+            break;
+        }
+        if (tab->sigWhite == sigB && tab->sigBlack == sigW) {
+            t = tab.get();
+            flip = true;
+            break;
+        }
+    }
+    if (t == nullptr) return GameResult::Ongoing;
+
+    // 表の白が盤の黒なら、段を上下反転して色を入れ替えて引く
+    int squares[BITBASE_MAX_PIECES];
+    for (int k = 0; k < t->n; k++) {
+        if (t->groupStart[k] != k) continue;
+        U64 bb = board.GetPieceBitboard(t->types[k], flip ? !t->white[k] : t->white[k]);
+        for (int j = k; j < t->n && t->groupStart[j] == k; j++) {
+            const int sq = __builtin_ctzll(bb);
+            bb &= bb - 1;
+            squares[j] = flip ? (sq ^ 56) : sq;
+        }
+    }
+    t->SortGroups(squares);
+    const bool whiteToMove = board.GetWhiteToMove();
+    const int v = t->Value(t->Index(flip ? !whiteToMove : whiteToMove, squares));
+    if (v == WIN) return whiteToMove ? GameResult::WhiteWin : GameResult::BlackWin;
+    if (v == LOSS) return whiteToMove ? GameResult::BlackWin : GameResult::WhiteWin;
+    return GameResult::Draw;
+}
+
+std::vector<std::string> Bitbases::Materials() const {
+    std::vector<std::string> out;
+    for (const auto& t : tables_) out.push_back(t->material);
+    return out;
+}
@@ -1,4 +1,5 @@
 #include "bitboard.hpp"
+#include "cpu_features.hpp"
 #include <iostream>
 
 Bitboard::Bitboard(U64 board) {
@@ -25,7 +26,7 @@ bool Bitboard::GetBit(Square square) const {
     return board & (1ULL << square);
 }
 
-int Bitboard::CountBits() const {
+CHESS_CLONES_POPCNT int Bitboard::CountBits() const {
     return __builtin_popcountll(board);
 }
 
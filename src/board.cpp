@@ -1,11 +1,13 @@
 #include "board.hpp"
+#include "evaluation.hpp"
 #include "movegen.hpp"
 #include "zobrist.hpp"
 #include <iostream>
 #include <sstream>
 #include <cctype>
 
-Board::Board() : whiteToMove(true), zobristHash(0), castlingRights_(0x0Fu), enPassantTarget_(-1), halfMoveClock_(0) {
+Board::Board() : whiteToMove(true), zobristHash(0), castlingRights_(0x0Fu), enPassantTarget_(-1), halfMoveClock_(0),
+                 mgScore_(0), egScore_(0), phase_(0) {
     Zobrist::Init();
     MoveGen::Init();
     whitePawns.SetBoard(0x000000000000FF00ULL);
@@ -24,6 +26,7 @@ Board::Board() : whiteToMove(true), zobristHash(0), castlingRights_(0x0Fu), enPa
     
     Update();
     ComputeZobristHash();
+    ComputeEvaluation();
 }
 
 namespace {
@@ -63,6 +66,25 @@ void Board::ComputeZobristHash() {
     zobristHash ^= CastlingEpHash(castlingRights_, enPassantTarget_);
 }
 
+void Board::ComputeEvaluation() {
+    mgScore_ = 0;
+    egScore_ = 0;
+    phase_ = 0;
+    for (int sq = 0; sq < 64; sq++) {
+        const Square s = static_cast<Square>(sq);
+        const int pt = GetPieceAt(s);
+        if (pt == NO_PIECE) continue;
+        const bool white = (GetWhitePieces() & (1ULL << sq)) != 0;
+        mgScore_ += Evaluation::Mg(pt, s, white);
+        egScore_ += Evaluation::Eg(pt, s, white);
+        phase_ += Evaluation::PhaseWeight(pt);
+    }
+}
+
+int Board::GetStaticEval() const {
+    return Evaluation::Taper(mgScore_, egScore_, phase_);
+}
+
 void Board::SetFromFen(const std::string& fen) {
     whitePawns.SetBoard(0); whiteKnights.SetBoard(0); whiteBishops.SetBoard(0);
     whiteRooks.SetBoard(0); whiteQueens.SetBoard(0); whiteKings.SetBoard(0);
@@ -124,6 +146,31 @@ void Board::SetFromFen(const std::string& fen) {
     undoStack_.clear();
     Update();
     ComputeZobristHash();
+    ComputeEvaluation();
+}
+
+void Board::SetPieces(const int* pieceTypes, const Square* squares, const bool* white, int n, bool whiteToMove) {
+    whitePawns.SetBoard(0); whiteKnights.SetBoard(0); whiteBishops.SetBoard(0);
+    whiteRooks.SetBoard(0); whiteQueens.SetBoard(0); whiteKings.SetBoard(0);
+    blackPawns.SetBoard(0); blackKnights.SetBoard(0); blackBishops.SetBoard(0);
+    blackRooks.SetBoard(0); blackQueens.SetBoard(0); blackKings.SetBoard(0);
+    // 駒が少ないので、盤全体を走査せず置いた駒からハッシュと評価値を作る（評価値は SetPieceAt が足す）
+    mgScore_ = 0;
+    egScore_ = 0;
+    phase_ = 0;
+    zobristHash = 0;
+    for (int i = 0; i < n; i++) {
+        SetPieceAt(squares[i], pieceTypes[i], white[i]);
+        zobristHash ^= Zobrist::GetPieceKey(squares[i], pieceTypes[i], white[i]);
+    }
+    this->whiteToMove = whiteToMove;
+    if (!whiteToMove) zobristHash ^= Zobrist::GetSideKey();
+    castlingRights_ = 0;
+    enPassantTarget_ = -1;
+    halfMoveClock_ = 0;
+    undoStack_.clear();
+    zobristHash ^= CastlingEpHash(castlingRights_, enPassantTarget_);
+    Update();
 }
 
 std::string Board::GetFen() const {
@@ -277,7 +324,22 @@ U64 Board::GetBlackPieces() const {
     return allBlackPieces.GetBoard();
 }
 
+U64 Board::GetPieceBitboard(int pieceType, bool white) const {
+    switch (pieceType) {
+        case PAWN: return (white ? whitePawns : blackPawns).GetBoard();
+        case KNIGHT: return (white ? whiteKnights : blackKnights).GetBoard();
+        case BISHOP: return (white ? whiteBishops : blackBishops).GetBoard();
+        case ROOK: return (white ? whiteRooks : blackRooks).GetBoard();
+        case QUEEN: return (white ? whiteQueens : blackQueens).GetBoard();
+        case KING: return (white ? whiteKings : blackKings).GetBoard();
+        default: return 0ULL;
+    }
+}
+
 void Board::ClearPieceAt(Square sq, int pieceType, bool white) {
+    mgScore_ -= Evaluation::Mg(pieceType, sq, white);
+    egScore_ -= Evaluation::Eg(pieceType, sq, white);
+    phase_ -= Evaluation::PhaseWeight(pieceType);
     if (white) {
         if (pieceType == PAWN) whitePawns.ClearBit(sq);
         else if (pieceType == KNIGHT) whiteKnights.ClearBit(sq);
@@ -296,6 +358,9 @@ void Board::ClearPieceAt(Square sq, int pieceType, bool white) {
 }
 
 void Board::SetPieceAt(Square sq, int pieceType, bool white) {
+    mgScore_ += Evaluation::Mg(pieceType, sq, white);
+    egScore_ += Evaluation::Eg(pieceType, sq, white);
+    phase_ += Evaluation::PhaseWeight(pieceType);
     if (white) {
         if (pieceType == PAWN) whitePawns.SetBit(sq);
         else if (pieceType == KNIGHT) whiteKnights.SetBit(sq);
@@ -0,0 +1,108 @@
+#include "board_batch.hpp"
+#include "encoding.hpp"
+#include "movegen.hpp"
+#include "thread_pool.hpp"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+    int findAction(const std::vector<Move>& moves, int32_t action) {
+        for (std::size_t k = 0; k < moves.size(); k++)
+            if (MoveToPolicyIndex(moves[k]) == action) return static_cast<int>(k);
+        return -1;
+    }
+}
+
+BoardBatch::BoardBatch(int size, const std::string& fen, int numThreads) : startFen_(fen) {
+    MoveGen::Init();
+    if (size <= 0) throw std::invalid_argument("BoardBatch size must be positive");
+    slots_.resize(static_cast<std::size_t>(size));
+    if (numThreads != 1) pool_.reset(new ThreadPool(numThreads));
+    Reset();
+}
+
+BoardBatch::~BoardBatch() = default;
+
+template <class Fn>
+void BoardBatch::forEach(Fn fn) const {
+    if (!pool_) {
+        for (std::size_t i = 0; i < slots_.size(); i++) fn(i);
+        return;
+    }
+    pool_->ParallelFor(slots_.size(), [&fn](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; i++) fn(i);
+    });
+}
+
+void BoardBatch::resetSlot(Slot& slot) {
+    slot.board = Board();
+    if (!startFen_.empty()) slot.board.SetFromFen(startFen_);
+    slot.hashCount.clear();
+    slot.hashCount[slot.board.GetZobristHash()] = 1;
+    slot.plies = 0;
+    refresh(slot);
+}
+
+void BoardBatch::refresh(Slot& slot) {
+    MoveGen::GenerateLegalMoves(slot.board, slot.moves);
+    if (slot.moves.empty()) {
+        const bool wtm = slot.board.GetWhiteToMove();
+        if (slot.board.IsInCheck(wtm))
+            slot.result = wtm ? GameResult::BlackWin : GameResult::WhiteWin;
+        else
+            slot.result = GameResult::Draw;
+    } else if (slot.board.GetHalfMoveClock() >= 100 || slot.hashCount[slot.board.GetZobristHash()] >= 3) {
+        slot.result = GameResult::Draw;
+    } else {
+        slot.result = GameResult::Ongoing;
+    }
+    if (slot.result != GameResult::Ongoing) slot.moves.clear();
+}
+
+void BoardBatch::Reset() {
+    forEach([this](std::size_t i) { resetSlot(slots_[i]); });
+}
+
+void BoardBatch::Reset(const std::size_t* indices, std::size_t n) {
+    for (std::size_t k = 0; k < n; k++) {
+        if (indices[k] >= slots_.size()) throw std::out_of_range("BoardBatch index out of range");
+    }
+    for (std::size_t k = 0; k < n; k++) resetSlot(slots_[indices[k]]);
+}
+
+void BoardBatch::Step(const int32_t* actions, int8_t* results) {
+    std::vector<int> chosen(slots_.size(), -1);
+    for (std::size_t i = 0; i < slots_.size(); i++) {
+        if (slots_[i].result != GameResult::Ongoing) continue;
+        chosen[i] = findAction(slots_[i].moves, actions[i]);
+        if (chosen[i] < 0)
+            throw std::invalid_argument("action " + std::to_string(actions[i]) + " is not legal in game " + std::to_string(i));
+    }
+    forEach([&](std::size_t i) {
+        Slot& slot = slots_[i];
+        if (chosen[i] >= 0) {
+            slot.board.MakeMove(slot.moves[static_cast<std::size_t>(chosen[i])]);
+            slot.plies++;
+            slot.hashCount[slot.board.GetZobristHash()]++;
+            refresh(slot);
+        }
+        if (results) results[i] = static_cast<int8_t>(slot.result);
+    });
+}
+
+void BoardBatch::LegalMask(uint8_t* out) const {
+    forEach([&](std::size_t i) {
+        uint8_t* row = out + i * POLICY_SIZE;
+        std::memset(row, 0, POLICY_SIZE);
+        for (const Move& m : slots_[i].moves) row[MoveToPolicyIndex(m)] = 1;
+    });
+}
+
+void BoardBatch::Results(int8_t* out) const {
+    for (std::size_t i = 0; i < slots_.size(); i++) out[i] = static_cast<int8_t>(slots_[i].result);
+}
+
+void BoardBatch::Encode(float* out) const {
+    forEach([&](std::size_t i) { EncodeBoard(slots_[i].board, out + i * INPUT_SIZE); });
+}
@@ -0,0 +1,45 @@
+#include "cpu_features.hpp"
+#include <cstdlib>
+#include <cstring>
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <cpuid.h>
+#endif
+
+namespace {
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+    /// AMD のファミリ 19h（Zen3）未満なら true。PEXT / PDEP がマイクロコード実装で、占有によっては百サイクルを超える
+    bool slowPext() {
+        unsigned int eax = 0, ebx = 0, ecx = 0, edx = 0;
+        if (!__get_cpuid(0, &eax, &ebx, &ecx, &edx)) return false;
+        char vendor[13];
+        std::memcpy(vendor, &ebx, 4);
+        std::memcpy(vendor + 4, &edx, 4);
+        std::memcpy(vendor + 8, &ecx, 4);
+        vendor[12] = '\0';
+        if (std::strcmp(vendor, "AuthenticAMD") != 0 && std::strcmp(vendor, "HygonGenuine") != 0) return false;
+        if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) return true;
+        unsigned int family = (eax >> 8) & 0xF;
+        if (family == 0xF) family += (eax >> 20) & 0xFF;
+        return family < 0x19;
+    }
+#endif
+
+    CpuFeatures detect() {
+        CpuFeatures f;
+        const char* isa = std::getenv("CHESS_ENGINE_ISA");
+        if (isa != nullptr && std::strcmp(isa, "generic") == 0) return f;
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+        __builtin_cpu_init();
+        f.popcnt = __builtin_cpu_supports("popcnt");
+        f.bmi2 = __builtin_cpu_supports("bmi2");
+        f.avx2 = __builtin_cpu_supports("avx2");
+        f.fastPext = f.bmi2 && !slowPext();
+#endif
+        return f;
+    }
+}
+
+const CpuFeatures& GetCpuFeatures() {
+    static const CpuFeatures features = detect();
+    return features;
+}
@@ -0,0 +1,46 @@
+#include "encoding.hpp"
+#include "move.hpp"
+#include <algorithm>
+
+namespace {
+    /// 駒以外の平面（手番・キャスリング・アンパッサン・50 手カウンタ）
+    void encodeState(bool whiteToMove, bool castling[4], int epSquare, int halfMoveClock, float* out) {
+        if (whiteToMove) std::fill(out + 12 * 64, out + 13 * 64, 1.0f);
+        for (int i = 0; i < 4; i++)
+            if (castling[i]) std::fill(out + (13 + i) * 64, out + (14 + i) * 64, 1.0f);
+        if (epSquare >= 0 && epSquare < 64) out[17 * 64 + epSquare] = 1.0f;
+        std::fill(out + 18 * 64, out + 19 * 64, static_cast<float>(halfMoveClock) / 100.0f);
+    }
+}
+
+void EncodeBoard(const Board& board, float* out) {
+    std::fill(out, out + INPUT_SIZE, 0.0f);
+    const U64 white = board.GetWhitePieces();
+    U64 occ = board.GetAllPieces();
+    while (occ) {
+        const int sq = __builtin_ctzll(occ);
+        occ &= occ - 1;
+        const int pt = board.GetPieceAt(static_cast<Square>(sq));
+        const int plane = (pt - PAWN) + ((white & (1ULL << sq)) ? 0 : 6);
+        out[plane * 64 + sq] = 1.0f;
+    }
+    bool castling[4] = {board.CanWhiteKingsideCastle(), board.CanWhiteQueensideCastle(),
+                        board.CanBlackKingsideCastle(), board.CanBlackQueensideCastle()};
+    encodeState(board.GetWhiteToMove(), castling, board.GetEnPassantTarget(), board.GetHalfMoveClock(), out);
+}
+
+void EncodePackedPosition(const PackedPosition& pos, float* out) {
+    std::fill(out, out + INPUT_SIZE, 0.0f);
+    U64 occ = pos.occupancy;
+    int n = 0;
+    while (occ && n < 32) {
+        const int sq = __builtin_ctzll(occ);
+        occ &= occ - 1;
+        const uint8_t code = (n % 2 == 0) ? (pos.pieces[n / 2] & 0x0F) : (pos.pieces[n / 2] >> 4);
+        const int pt = code & 7;
+        if (pt >= PAWN && pt <= KING) out[((pt - PAWN) + ((code & 8) ? 6 : 0)) * 64 + sq] = 1.0f;
+        n++;
+    }
+    bool castling[4] = {(pos.flags & 2u) != 0, (pos.flags & 4u) != 0, (pos.flags & 8u) != 0, (pos.flags & 16u) != 0};
+    encodeState((pos.flags & 1u) != 0, castling, pos.epSquare, pos.halfMoveClock, out);
+}
@@ -0,0 +1,90 @@
+#include "eval_cache.hpp"
+#include <algorithm>
+
+namespace {
+    /// 合法手の列（順序込み）のハッシュ。Zobrist キーが衝突しても、手の列まで一致することはまずない
+    U64 movesKey(const std::vector<Move>& moves) {
+        U64 h = 0x9E3779B97F4A7C15ULL ^ moves.size();
+        for (const Move& m : moves) {
+            h ^= static_cast<U64>(m.from) | (static_cast<U64>(m.to) << 6) | (static_cast<U64>(m.promotionPiece) << 12);
+            h *= 0xFF51AFD7ED558CCDULL;
+            h ^= h >> 33;
+        }
+        return h;
+    }
+}
+
+EvalCache::EvalCache(std::size_t capacity, std::size_t numShards) {
+    numShards_ = 1;
+    shardBits_ = 0;
+    while (numShards_ < numShards && numShards_ < (1u << 16)) {
+        numShards_ <<= 1;
+        shardBits_++;
+    }
+    shardMask_ = numShards_ - 1;
+    entriesPerShard_ = std::max<std::size_t>(1, (capacity + numShards_ - 1) / numShards_);
+    shards_.reset(new Shard[numShards_]);
+    for (std::size_t i = 0; i < numShards_; i++)
+        shards_[i].entries.resize(entriesPerShard_);
+}
+
+bool EvalCache::Lookup(U64 key, const std::vector<Move>& moves, std::vector<double>& priors, double& value) {
+    lookups_.fetch_add(1, std::memory_order_relaxed);
+    const U64 check = movesKey(moves);
+    Shard& shard = ShardFor(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    const Entry& e = shard.entries[SlotFor(key)];
+    if (!e.used || e.key != key || e.priors.size() != moves.size() || e.movesKey != check) return false;
+    priors.assign(e.priors.begin(), e.priors.end());
+    value = e.value;
+    hits_.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+void EvalCache::Insert(U64 key, const std::vector<Move>& moves, const std::vector<double>& priors, double value) {
+    const U64 check = movesKey(moves);
+    Shard& shard = ShardFor(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    Entry& e = shard.entries[SlotFor(key)];
+    if (e.used && e.key != key) evictions_.fetch_add(1, std::memory_order_relaxed);
+    e.key = key;
+    e.movesKey = check;
+    e.used = true;
+    e.value = static_cast<float>(value);
+    e.priors.assign(priors.begin(), priors.end());
+    inserts_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void EvalCache::Clear() {
+    for (std::size_t i = 0; i < numShards_; i++) {
+        std::lock_guard<std::mutex> lock(shards_[i].mutex);
+        for (Entry& e : shards_[i].entries) {
+            e.used = false;
+            e.priors.clear();
+            e.priors.shrink_to_fit();
+        }
+    }
+}
+
+EvalCache::Stats EvalCache::GetStats() const {
+    Stats s;
+    s.lookups = lookups_.load(std::memory_order_relaxed);
+    s.hits = hits_.load(std::memory_order_relaxed);
+    s.inserts = inserts_.load(std::memory_order_relaxed);
+    s.evictions = evictions_.load(std::memory_order_relaxed);
+    s.capacity = numShards_ * entriesPerShard_;
+    s.size = 0;
+    for (std::size_t i = 0; i < numShards_; i++) {
+        std::lock_guard<std::mutex> lock(shards_[i].mutex);
+        for (const Entry& e : shards_[i].entries)
+            if (e.used) s.size++;
+    }
+    return s;
+}
+
+void EvalCache::ResetStats() {
+    lookups_.store(0, std::memory_order_relaxed);
+    hits_.store(0, std::memory_order_relaxed);
+    inserts_.store(0, std::memory_order_relaxed);
+    evictions_.store(0, std::memory_order_relaxed);
+}
@@ -0,0 +1,110 @@
+#include "evaluation.hpp"
+#include "move.hpp"
+#include <algorithm>
+
+namespace {
+    const int kMgValue[7] = {0, 82, 337, 365, 477, 1025, 0};
+    const int kEgValue[7] = {0, 94, 281, 297, 512, 936, 0};
+    const int kPhaseWeight[7] = {0, 0, 1, 1, 2, 4, 0};
+
+    // 白から見た表（先頭が 8 段目）。白は sq ^ 56、黒は sq でそのまま引く
+    const int kPawnMg[64] = {
+          0,   0,   0,   0,   0,   0,   0,   0,
+         50,  50,  50,  50,  50,  50,  50,  50,
+         10,  10,  20,  30,  30,  20,  10,  10,
+          5,   5,  10,  25,  25,  10,   5,   5,
+          0,   0,   0,  20,  20,   0,   0,   0,
+          5,  -5, -10,   0,   0, -10,  -5,   5,
+          5,  10,  10, -20, -20,  10,  10,   5,
+          0,   0,   0,   0,   0,   0,   0,   0};
+    const int kPawnEg[64] = {
+          0,   0,   0,   0,   0,   0,   0,   0,
+         80,  80,  80,  80,  80,  80,  80,  80,
+         50,  50,  50,  50,  50,  50,  50,  50,
+         30,  30,  30,  30,  30,  30,  30,  30,
+         15,  15,  15,  15,  15,  15,  15,  15,
+          5,   5,   5,   5,   5,   5,   5,   5,
+          0,   0,   0,   0,   0,   0,   0,   0,
+          0,   0,   0,   0,   0,   0,   0,   0};
+    const int kKnight[64] = {
+        -50, -40, -30, -30, -30, -30, -40, -50,
+        -40, -20,   0,   0,   0,   0, -20, -40,
+        -30,   0,  10,  15,  15,  10,   0, -30,
+        -30,   5,  15,  20,  20,  15,   5, -30,
+        -30,   0,  15,  20,  20,  15,   0, -30,
+        -30,   5,  10,  15,  15,  10,   5, -30,
+        -40, -20,   0,   5,   5,   0, -20, -40,
+        -50, -40, -30, -30, -30, -30, -40, -50};
+    const int kBishop[64] = {
+        -20, -10, -10, -10, -10, -10, -10, -20,
+        -10,   0,   0,   0,   0,   0,   0, -10,
+        -10,   0,   5,  10,  10,   5,   0, -10,
+        -10,   5,   5,  10,  10,   5,   5, -10,
+        -10,   0,  10,  10,  10,  10,   0, -10,
+        -10,  10,  10,  10,  10,  10,  10, -10,
+        -10,   5,   0,   0,   0,   0,   5, -10,
+        -20, -10, -10, -10, -10, -10, -10, -20};
+    const int kRook[64] = {
+          0,   0,   0,   0,   0,   0,   0,   0,
+          5,  10,  10,  10,  10,  10,  10,   5,
+         -5,   0,   0,   0,   0,   0,   0,  -5,
+         -5,   0,   0,   0,   0,   0,   0,  -5,
+         -5,   0,   0,   0,   0,   0,   0,  -5,
+         -5,   0,   0,   0,   0,   0,   0,  -5,
+         -5,   0,   0,   0,   0,   0,   0,  -5,
+          0,   0,   0,   5,   5,   0,   0,   0};
+    const int kQueen[64] = {
+        -20, -10, -10,  -5,  -5, -10, -10, -20,
+        -10,   0,   0,   0,   0,   0,   0, -10,
+        -10,   0,   5,   5,   5,   5,   0, -10,
+         -5,   0,   5,   5,   5,   5,   0,  -5,
+          0,   0,   5,   5,   5,   5,   0,  -5,
+        -10,   5,   5,   5,   5,   5,   0, -10,
+        -10,   0,   5,   0,   0,   0,   0, -10,
+        -20, -10, -10,  -5,  -5, -10, -10, -20};
+    const int kKingMg[64] = {
+        -30, -40, -40, -50, -50, -40, -40, -30,
+        -30, -40, -40, -50, -50, -40, -40, -30,
+        -30, -40, -40, -50, -50, -40, -40, -30,
+        -30, -40, -40, -50, -50, -40, -40, -30,
+        -20, -30, -30, -40, -40, -30, -30, -20,
+        -10, -20, -20, -20, -20, -20, -20, -10,
+         20,  20,   0,   0,   0,   0,  20,  20,
+         20,  30,  10,   0,   0,  10,  30,  20};
+    const int kKingEg[64] = {
+        -50, -40, -30, -20, -20, -30, -40, -50,
+        -30, -20, -10,   0,   0, -10, -20, -30,
+        -30, -10,  20,  30,  30,  20, -10, -30,
+        -30, -10,  30,  40,  40,  30, -10, -30,
+        -30, -10,  30,  40,  40,  30, -10, -30,
+        -30, -10,  20,  30,  30,  20, -10, -30,
+        -30, -30,   0,   0,   0,   0, -30, -30,
+        -50, -30, -30, -30, -30, -30, -30, -50};
+
+    const int* const kMgTable[7] = {nullptr, kPawnMg, kKnight, kBishop, kRook, kQueen, kKingMg};
+    const int* const kEgTable[7] = {nullptr, kPawnEg, kKnight, kBishop, kRook, kQueen, kKingEg};
+
+    int lookup(const int* const tables[7], const int values[7], int pieceType, Square sq, bool isWhite) {
+        if (pieceType < PAWN || pieceType > KING) return 0;
+        const int idx = isWhite ? (static_cast<int>(sq) ^ 56) : static_cast<int>(sq);
+        const int v = values[pieceType] + tables[pieceType][idx];
+        return isWhite ? v : -v;
+    }
+}
+
+int Evaluation::Mg(int pieceType, Square sq, bool isWhite) {
+    return lookup(kMgTable, kMgValue, pieceType, sq, isWhite);
+}
+
+int Evaluation::Eg(int pieceType, Square sq, bool isWhite) {
+    return lookup(kEgTable, kEgValue, pieceType, sq, isWhite);
+}
+
+int Evaluation::PhaseWeight(int pieceType) {
+    return (pieceType >= PAWN && pieceType <= KING) ? kPhaseWeight[pieceType] : 0;
+}
+
+int Evaluation::Taper(int mg, int eg, int phase) {
+    const int p = std::min(std::max(phase, 0), MAX_PHASE);
+    return (mg * p + eg * (MAX_PHASE - p)) / MAX_PHASE;
+}
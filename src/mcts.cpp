@@ -1,98 +1,52 @@
 #include "mcts.hpp"
+#include "batch_search.hpp"
+#include "eval_cache.hpp"
+#include "mcts_detail.hpp"
+#include "mcts_search.hpp"
 #include "movegen.hpp"
 #include "move.hpp"
+#include "opening_book.hpp"
+#include "thread_pool.hpp"
+#include "tracer.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <cmath>
+#include <deque>
+#include <future>
+#include <memory>
 #include <random>
-#include <set>
 #include <string>
-#include <unordered_map>
 #include <vector>
 
-namespace {
-    /// ルート用: prior にディリクレノイズを混合。alpha<=0 のときは prior をそのまま返す。
-    void applyDirichletToPriors(std::vector<double>& priors, double alpha, double epsilon, std::mt19937& gen) {
-        if (alpha <= 0.0 || priors.empty()) return;
-        const std::size_t K = priors.size();
-        std::gamma_distribution<double> gamma(alpha, 1.0);
-        std::vector<double> noise(K);
-        double sumN = 0.0;
-        for (std::size_t i = 0; i < K; i++) {
-            noise[i] = std::max(gamma(gen), 1e-10);
-            sumN += noise[i];
-        }
-        if (sumN <= 0.0) return;
-        double sumP = 0.0;
-        for (std::size_t i = 0; i < K; i++) {
-            noise[i] /= sumN;
-            priors[i] = (1.0 - epsilon) * priors[i] + epsilon * noise[i];
-            if (priors[i] > 0.0) sumP += priors[i];
-        }
-        if (sumP <= 0.0) return;
-        for (std::size_t i = 0; i < K; i++)
-            priors[i] /= sumP;
+using namespace mcts_detail;
+
+const char* StopReasonToString(MCTSStopReason reason) {
+    switch (reason) {
+        case MCTSStopReason::Iterations: return "iterations";
+        case MCTSStopReason::TimeLimit: return "time";
+        case MCTSStopReason::NodeLimit: return "nodes";
+        case MCTSStopReason::SmartPruning: return "smart_pruning";
+        case MCTSStopReason::Converged: return "converged";
+        case MCTSStopReason::Proven: return "proven";
+        case MCTSStopReason::Stopped: return "stopped";
+        case MCTSStopReason::Book: return "book";
     }
+    return "iterations";
 }
 
-namespace {
-    static double resultToValue(GameResult r, bool rootWhite) {
-        if (r == GameResult::Draw) return 0.0;
-        if (r == GameResult::WhiteWin) return rootWhite ? 1.0 : -1.0;
-        if (r == GameResult::BlackWin) return rootWhite ? -1.0 : 1.0;
-        return 0.0;
-    }
-
-    static void deleteTree(MCTSNode* n) {
-        if (!n) return;
-        for (MCTSNode* c : n->children)
-            deleteTree(c);
-        delete n;
-    }
-
-    static std::string moveToUci(const Move& m) {
-        std::string s = SquareToStr(m.from) + SquareToStr(m.to);
-        if (m.promotionPiece != NO_PIECE) {
-            char c = 'q';
-            if (m.promotionPiece == ROOK) c = 'r';
-            else if (m.promotionPiece == BISHOP) c = 'b';
-            else if (m.promotionPiece == KNIGHT) c = 'n';
-            s += c;
-        }
-        return s;
-    }
-
-    static std::vector<std::string> movesToUci(const std::vector<Move>& moves) {
-        std::vector<std::string> out;
-        out.reserve(moves.size());
-        for (const Move& m : moves) out.push_back(moveToUci(m));
-        return out;
-    }
-
-    /// PFU: 未訪問子の初期値。parent_value - pfu_scale/sqrt(parent_N) を [-1,1] にクリップ。pfu_scale<=0 または parent->N==0 なら 0。
-    static double getPfuInitialValue(const MCTSNode* parent, const MCTSNode* child, double pfu_scale) {
-        if (pfu_scale <= 0.0 || parent->N <= 0 || child->N > 0) return 0.0;
-        double parentValue = parent->W / static_cast<double>(parent->N);
-        double delta = pfu_scale / std::sqrt(static_cast<double>(parent->N));
-        double v = parentValue - delta;
-        if (v < -1.0) return -1.0;
-        if (v > 1.0) return 1.0;
-        return v;
-    }
-
-    enum WorkerState { RUN, NEED_EVAL };  // NEED_EVAL: リーフ到達。同一局面で Prior+Value 取得 → バックプロパ → 展開 → 1手進める
-
-    struct Worker {
-        Board board;
-        MCTSNode* node;
-        WorkerState state = RUN;
-        std::vector<Move> moves;
-    };
+std::size_t MCTSTreeBytes(long nodeCount) {
+    if (nodeCount <= 0) return 0;
+    // 展開時に children を合法手数ちょうどで確保するので、ルート以外のノードは親の children に 1 要素ずつ持つ
+    return static_cast<std::size_t>(nodeCount) * sizeof(MCTSNode) + static_cast<std::size_t>(nodeCount - 1) * sizeof(MCTSNode*);
 }
 
 MCTSResult RunMCTS(const Board& rootBoard, int iterations, std::mt19937& gen) {
     return RunMCTS(rootBoard, iterations, gen, MCTSOptions{});
 }
 
-static MCTSResult RunMCTSBatch(const Board& rootBoard, int iterations, std::mt19937& gen, const MCTSOptions& options);
+static MCTSResult RunMCTSBatch(const Board& rootBoard, int iterations, std::mt19937& gen, const MCTSOptions& options,
+                               const MCTSResult* seed);
 
 MCTSResult RunMCTS(const Board& rootBoard, int iterations, std::mt19937& gen, const MCTSOptions& options) {
     MCTSResult out;
@@ -100,332 +54,217 @@ MCTSResult RunMCTS(const Board& rootBoard, int iterations, std::mt19937& gen, co
     out.rootVisits = 0;
     if (iterations <= 0) return out;
 
-    if (options.batch_eval_fn || (options.batch_prior_fn && options.batch_value_fn)) {
-        return RunMCTSBatch(rootBoard, iterations, gen, options);
+    // 定跡に十分な訪問があればそのまま返し、足りなければ保存結果を木に埋めて残りの訪問だけ探索する
+    MCTSResult booked;
+    const MCTSResult* seed = nullptr;
+    if (options.book != nullptr && options.book->Lookup(rootBoard, booked)) {
+        if (booked.rootVisits >= iterations || booked.provenResult != GameResult::Ongoing) return booked;
+        seed = &booked;
+        iterations -= booked.rootVisits;
+    }
+
+    if (options.batch_array_fn || options.batch_eval_fn || (options.batch_prior_fn && options.batch_value_fn)) {
+        return RunMCTSBatch(rootBoard, iterations, gen, options, seed);
     }
 
-    const double c_puct = options.c_puct;
+    FunctionEvaluator evaluator(options);
+    OptionsPlayout playout(options.playout);
+    if (seed == nullptr) return RunMCTS(rootBoard, iterations, gen, options, evaluator, playout);
     MCTSNode* root = new MCTSNode();
     root->parent = nullptr;
-    root->N = 0;
-    root->W = 0.0;
     root->P = 0.0;
-    bool rootWhite = rootBoard.GetWhiteToMove();
-
-    for (int iter = 0; iter < iterations; iter++) {
-        Board board = rootBoard;
-        MCTSNode* node = root;
-
-        while (true) {
-            if (node->children.empty()) {
-                std::vector<Move> moves;
-                MoveGen::GenerateLegalMoves(board, moves);
-                if (moves.empty()) {
-                    double value = resultToValue(MoveGen::GetGameResult(board), rootWhite);
-                    double sign = 1.0;
-                    for (MCTSNode* p = node; p != nullptr; p = p->parent) {
-                        p->N++;
-                        p->W += sign * value;
-                        sign = -sign;
-                    }
-                    break;
-                }
-
-                double value;
-                if (options.value_fn) {
-                    value = options.value_fn(board);
-                } else {
-                    value = resultToValue(MoveGen::DoRandomPlayout(board, gen), rootWhite);
-                }
-                double sign = 1.0;
-                for (MCTSNode* p = node; p != nullptr; p = p->parent) {
-                    p->N++;
-                    p->W += sign * value;
-                    sign = -sign;
-                }
-                std::vector<double> priors;
-                if (options.prior_fn) {
-                    priors = options.prior_fn(board, moves);
-                    if (priors.size() != moves.size()) priors.clear();
-                }
-                double sumP = 0.0;
-                if (!priors.empty()) {
-                    for (double x : priors) sumP += (x > 0.0 ? x : 0.0);
-                }
-                const double uniformP = 1.0 / static_cast<double>(moves.size());
-                std::vector<double> p(moves.size());
-                for (std::size_t i = 0; i < moves.size(); i++) {
-                    if (sumP > 0.0 && i < priors.size() && priors[i] > 0.0)
-                        p[i] = priors[i] / sumP;
-                    else
-                        p[i] = uniformP;
-                }
-                const bool isRoot = (node->parent == nullptr);
-                if (isRoot && options.dirichlet_alpha > 0.0)
-                    applyDirichletToPriors(p, options.dirichlet_alpha, options.dirichlet_epsilon, gen);
-                for (std::size_t i = 0; i < moves.size(); i++) {
-                    MCTSNode* c = new MCTSNode();
-                    c->move_from_parent = moves[i];
-                    c->parent = node;
-                    c->N = 0;
-                    c->W = 0.0;
-                    c->P = p[i];
-                    node->children.push_back(c);
-                }
-                MCTSNode* best = nullptr;
-                double bestScore = -1e99;
-                int parentN = node->N;
-                for (MCTSNode* c : node->children) {
-                    double score = c_puct * c->P * std::sqrt(static_cast<double>(parentN + 1)) / (1.0 + c->N);
-                    if (c->N > 0)
-                        score += c->W / c->N;
-                    else if (options.pfu_scale > 0.0)
-                        score += getPfuInitialValue(node, c, options.pfu_scale);
-                    if (score > bestScore) {
-                        bestScore = score;
-                        best = c;
-                    }
-                }
-                if (!best) break;
-                board.MakeMove(best->move_from_parent);
-                node = best;
-                break;
-            }
-
-            MCTSNode* best = nullptr;
-            double bestScore = -1e99;
-            int parentN = node->N;
-            for (MCTSNode* c : node->children) {
-                double score = c_puct * c->P * std::sqrt(static_cast<double>(parentN + 1)) / (1.0 + c->N);
-                if (c->N > 0)
-                    score += c->W / c->N;
-                else if (options.pfu_scale > 0.0)
-                    score += getPfuInitialValue(node, c, options.pfu_scale);
-                if (score > bestScore) {
-                    bestScore = score;
-                    best = c;
-                }
-            }
-            if (!best) break;
-            board.MakeMove(best->move_from_parent);
-            node = best;
-        }
-    }
-
-    out.rootVisits = root->N;
-    out.rootValue = (root->N > 0) ? (root->W / root->N) : 0.0;
-    for (MCTSNode* c : root->children)
-        out.visits.push_back({c->move_from_parent, c->N});
-
+    long nodeCount = 1 + seedRoot(root, *seed);
+    out = SearchMCTS(root, nodeCount, rootBoard, iterations, gen, options, evaluator, playout);
     deleteTree(root);
     return out;
 }
 
-static MCTSResult RunMCTSBatch(const Board& rootBoard, int iterations, std::mt19937& gen, const MCTSOptions& options) {
-    const double c_puct = options.c_puct;
+static MCTSResult RunMCTSBatch(const Board& rootBoard, int iterations, std::mt19937& gen, const MCTSOptions& options,
+                               const MCTSResult* seed) {
     const int W = std::max(1, std::min(options.batch_size, 1024));
-    const bool rootWhite = rootBoard.GetWhiteToMove();
-
-    MCTSNode* root = new MCTSNode();
-    root->parent = nullptr;
-    root->N = 0;
-    root->W = 0.0;
-    root->P = 0.0;
-
-    std::vector<Worker> workers(static_cast<std::size_t>(W));
-    for (int i = 0; i < W; i++) {
-        workers[i].board = rootBoard;
-        workers[i].node = root;
-        workers[i].state = RUN;
-    }
-
-    int completed = 0;
-
-    while (completed < iterations) {
-        // --- Flush Eval (AlphaZero-style: same FEN for prior+value, then backprop → expand → move) ---
-        using EvalEntry = std::pair<std::size_t, std::pair<MCTSNode*, std::vector<Move>>>;
-        // std::map だと辞書順になり、バッチ推論の戻り値インデックスと直感がズレる。
-        // ワーカー走査順で初出の FEN だけ列挙し、Python 側のリスト順と厳密に対応させる。
-        std::vector<std::string> batch_fens;
-        std::vector<std::vector<std::string>> batch_uci;
-        std::vector<std::vector<EvalEntry>> batch_entries;
-        std::unordered_map<std::string, std::size_t> fen_to_batch;
-        batch_fens.reserve(workers.size());
-        batch_uci.reserve(workers.size());
-        batch_entries.reserve(workers.size());
-        fen_to_batch.reserve(workers.size() * 2);
-
-        for (std::size_t i = 0; i < workers.size(); i++) {
-            Worker& w = workers[i];
-            if (w.state != NEED_EVAL) continue;
-            const std::string fen = w.board.GetFen();
-            auto ins = fen_to_batch.emplace(fen, batch_fens.size());
-            if (ins.second) {
-                batch_fens.push_back(fen);
-                batch_uci.push_back(movesToUci(w.moves));
-                batch_entries.emplace_back();
+    const int depth = std::max(1, std::min(options.pipeline_depth, 8));
+
+    // パイプライン時は評価中のバッチの裏で次のバッチを集めるため、ワーカーを depth 倍用意する
+    BatchSearch search(rootBoard, W * depth, gen, options);
+    if (seed != nullptr) search.Seed(*seed);
+    search.SetBudget(iterations);
+    SearchBudget budget(iterations, options);
+
+    Tracer* tracer = options.tracer;
+    if (depth <= 1) {
+        EvalBatch batch;
+        while (!budget.ShouldStop(search.Root(), search.Completed(), search.NodeCount())) {
+            // --- Advance RUN workers: 全員がリーフに着くか衝突上限で待機するまで進め、バッチを埋める ---
+            {
+                TraceSpan span(tracer, "advance");
+                while (search.CountState(RUN) > 0 && search.CountState(NEED_EVAL) < static_cast<std::size_t>(W) &&
+                       search.Completed() < iterations && !search.Solved())
+                    search.Advance();
             }
-            const std::size_t bi = ins.first->second;
-            batch_entries[bi].push_back({i, {w.node, w.moves}});
-        }
-        if (!batch_fens.empty()) {
-            std::vector<std::vector<double>> priorResults;
-            std::vector<double> values;
-            if (options.batch_eval_fn) {
-                BatchEvalResult evalResult = options.batch_eval_fn(batch_fens, batch_uci);
-                priorResults = std::move(evalResult.priors);
-                values = std::move(evalResult.values);
-            } else {
-                priorResults = options.batch_prior_fn(batch_fens, batch_uci);
-                values = options.batch_value_fn(batch_fens);
-            }
-            if (priorResults.size() != batch_fens.size()) priorResults.clear();
-            if (values.size() != batch_fens.size()) values.assign(batch_fens.size(), 0.0);
-
-            for (std::size_t fi = 0; fi < batch_fens.size(); fi++) {
-                const std::vector<double>& priors = (fi < priorResults.size()) ? priorResults[fi] : std::vector<double>();
-                const auto& entries = batch_entries[fi];
-                const std::vector<Move>& moves = entries.front().second.second;
-                double sumP = 0.0;
-                if (priors.size() == moves.size()) {
-                    for (double x : priors) sumP += (x > 0.0 ? x : 0.0);
-                }
-                const double uniformP = 1.0 / static_cast<double>(moves.size());
-                std::vector<double> p(moves.size());
-                for (std::size_t i = 0; i < moves.size(); i++) {
-                    if (sumP > 0.0 && i < priors.size() && priors[i] > 0.0)
-                        p[i] = priors[i] / sumP;
-                    else
-                        p[i] = uniformP;
-                }
-                const bool isRootForFen = (entries.front().second.first->parent == nullptr);
-                if (isRootForFen && options.dirichlet_alpha > 0.0)
-                    applyDirichletToPriors(p, options.dirichlet_alpha, options.dirichlet_epsilon, gen);
-
-                std::set<MCTSNode*> expanded;
-                for (const auto& e : entries) {
-                    MCTSNode* node = e.second.first;
-                    if (expanded.count(node)) continue;
-                    expanded.insert(node);
-                    const std::vector<Move>& mov = e.second.second;
-                    for (std::size_t i = 0; i < mov.size(); i++) {
-                        MCTSNode* c = new MCTSNode();
-                        c->move_from_parent = mov[i];
-                        c->parent = node;
-                        c->N = 0;
-                        c->W = 0.0;
-                        c->P = p[i];
-                        node->children.push_back(c);
-                    }
+            // --- Flush Eval (AlphaZero-style: same FEN for prior+value, then backprop → expand → move) ---
+            // 残り反復数を超えるリーフは評価せず、次の周回に残す
+            const int remaining = iterations - search.Completed();
+            if (remaining <= 0) break;
+            batch.Clear();
+            search.Gather(batch, std::min(search.NumWorkers(), static_cast<std::size_t>(remaining)));
+            if (!batch.entries.empty()) {
+                StatsClock clock(options.collect_stats);
+                {
+                    TraceSpan span(tracer, "evaluate");
+                    evaluateBatch(batch, options);
                 }
+                clock.Lap(batch.evalMs);
+                search.Integrate(batch, iterations - search.Completed());
             }
-
-            int remaining = std::max(0, iterations - completed);
-            for (std::size_t fi = 0; fi < batch_fens.size() && remaining > 0; fi++) {
-                double value = (fi < values.size()) ? values[fi] : 0.0;
-                for (const auto& e : batch_entries[fi]) {
-                    if (remaining <= 0) break;
-                    std::size_t idx = e.first;
-                    MCTSNode* leaf = e.second.first;
-                    Worker& w = workers[idx];
-                    double sign = 1.0;
-                    for (MCTSNode* p = leaf; p != nullptr; p = p->parent) {
-                        p->N++;
-                        p->W += sign * value;
-                        if (p->parent != nullptr) p->N_virtual = std::max(0, p->N_virtual - 1);
-                        sign = -sign;
-                    }
-                    completed++;
-                    remaining--;
-                    int parentN = leaf->N;
-                    MCTSNode* best = nullptr;
-                    double bestScore = -1e99;
-                    for (MCTSNode* c : leaf->children) {
-                        double denom = 1.0 + c->N + c->N_virtual;
-                        double score = c_puct * c->P * std::sqrt(static_cast<double>(parentN + 1)) / denom;
-                        if (c->N > 0) score += c->W / c->N;
-                        else if (options.pfu_scale > 0.0) score += getPfuInitialValue(leaf, c, options.pfu_scale);
-                        if (score > bestScore) { bestScore = score; best = c; }
-                    }
-                    if (best) {
-                        best->N_virtual += 1;
-                        w.board.MakeMove(best->move_from_parent);
-                        w.node = best;
-                    }
-                    w.state = RUN;
-                }
+            search.EnforceMemoryLimit();
+        }
+    } else {
+        // パイプライン: 評価器は別スレッドで最大 depth-1 バッチを処理し、その間に探索側は仮想損失付きで次のリーフを集める。
+        // 木の更新（展開・バックアップ）は常にこのスレッドで行う。
+        struct InFlight {
+            std::unique_ptr<EvalBatch> batch;
+            std::size_t leaves;  // 積んだワーカー数
+            std::future<void> done;
+        };
+        std::deque<InFlight> inflight;
+        // 評価が終わったバッチは中身を空にして使い回す（batch_array_fn の連結バッファも確保し直さない）
+        std::vector<std::unique_ptr<EvalBatch>> spare;
+        int inflightLeaves = 0;
+        auto integrateFront = [&]() {
+            {
+                // 評価スレッドの結果待ち（探索側が評価器を待って止まっている区間）
+                TraceSpan span(tracer, "wait_eval");
+                inflight.front().done.get();
             }
-            for (Worker& w : workers) {
-                if (w.state == NEED_EVAL) {
-                    w.state = RUN;
-                    w.board = rootBoard;
-                    w.node = root;
-                }
+            search.Integrate(*inflight.front().batch, iterations - search.Completed());
+            inflightLeaves -= static_cast<int>(inflight.front().leaves);
+            spare.push_back(std::move(inflight.front().batch));
+            inflight.pop_front();
+        };
+        // 評価中のリーフを除いた残り反復数までしか積まない（超えた分は Integrate で捨てることになる）
+        auto gatherCap = [&]() {
+            return static_cast<std::size_t>(std::max(0, std::min(W, iterations - search.Completed() - inflightLeaves)));
+        };
+        while (true) {
+            while (!inflight.empty() &&
+                   inflight.front().done.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+                integrateFront();
+            search.EnforceMemoryLimit();
+            if (budget.ShouldStop(search.Root(), search.Completed(), search.NodeCount())) break;
+
+            {
+                TraceSpan span(tracer, "advance");
+                search.Advance();
             }
-        }
-
-        // --- Advance RUN workers ---
-        for (std::size_t i = 0; i < workers.size(); i++) {
-            Worker& w = workers[i];
-            if (w.state != RUN) continue;
-
-            if (w.node->children.empty()) {
-                MoveGen::GenerateLegalMoves(w.board, w.moves);
-                if (w.moves.empty()) {
-                    double value = resultToValue(MoveGen::GetGameResult(w.board), rootWhite);
-                    double sign = 1.0;
-                    for (MCTSNode* p = w.node; p != nullptr; p = p->parent) {
-                        p->N++;
-                        p->W += sign * value;
-                        if (p->parent != nullptr) p->N_virtual = std::max(0, p->N_virtual - 1);
-                        sign = -sign;
-                    }
-                    completed++;
-                    w.board = rootBoard;
-                    w.node = root;
-                    w.state = RUN;
-                    continue;
+            const std::size_t needEval = search.CountState(NEED_EVAL);
+            const std::size_t running = search.CountState(RUN);
+            const std::size_t cap = gatherCap();
+            if (cap > 0 && needEval > 0 && (needEval >= cap || running == 0)) {
+                if (inflight.size() >= static_cast<std::size_t>(depth - 1)) {
+                    integrateFront();
+                    if (gatherCap() == 0) continue;
                 }
-                w.state = NEED_EVAL;
-                continue;
-            }
-
-            int parentN = w.node->N;
-            MCTSNode* best = nullptr;
-            double bestScore = -1e99;
-            for (MCTSNode* c : w.node->children) {
-                double denom = 1.0 + c->N + c->N_virtual;
-                double score = c_puct * c->P * std::sqrt(static_cast<double>(parentN + 1)) / denom;
-                if (c->N > 0) score += c->W / c->N;
-                else if (options.pfu_scale > 0.0) score += getPfuInitialValue(w.node, c, options.pfu_scale);
-                if (score > bestScore) { bestScore = score; best = c; }
+                InFlight f;
+                if (spare.empty()) {
+                    f.batch.reset(new EvalBatch());
+                } else {
+                    f.batch = std::move(spare.back());
+                    spare.pop_back();
+                    f.batch->Clear();
+                }
+                f.leaves = search.Gather(*f.batch, gatherCap());
+                inflightLeaves += static_cast<int>(f.leaves);
+                EvalBatch* b = f.batch.get();
+                f.done = std::async(std::launch::async, [b, &options, tracer]() {
+                    StatsClock clock(options.collect_stats);
+                    TraceSpan span(tracer, "evaluate");
+                    evaluateBatch(*b, options);
+                    clock.Lap(b->evalMs);
+                });
+                inflight.push_back(std::move(f));
+            } else if ((running == 0 || cap == 0) && !inflight.empty()) {
+                integrateFront();
             }
-            if (!best) continue;
-            best->N_virtual += 1;
-            w.board.MakeMove(best->move_from_parent);
-            w.node = best;
         }
+        while (!inflight.empty()) integrateFront();
     }
 
-    MCTSResult out;
-    out.rootVisits = root->N;
-    out.rootValue = (root->N > 0) ? (root->W / root->N) : 0.0;
-    for (MCTSNode* c : root->children)
-        out.visits.push_back({c->move_from_parent, c->N});
-
-    deleteTree(root);
+    MCTSResult out = search.Result();
+    out.stopReason = budget.Reason();
+    out.elapsedMs = budget.ElapsedMs();
     return out;
 }
 
+std::vector<MCTSResult> RunMCTSMany(const std::vector<Board>& roots, int iterations, const std::vector<unsigned int>& seeds,
+                                    const MCTSOptions& options, int numThreads) {
+    MoveGen::Init();
+    std::vector<MCTSResult> results(roots.size());
+    if (roots.empty()) return results;
+    ThreadPool pool(std::min(numThreads > 0 ? numThreads : static_cast<int>(std::thread::hardware_concurrency()),
+                             static_cast<int>(roots.size())));
+    // 探索時間はルートごとにばらつくので、固定チャンクではなく各スレッドが次のルートを取りに行く
+    std::atomic<std::size_t> next(0);
+    pool.ParallelFor(static_cast<std::size_t>(pool.NumThreads()), [&](std::size_t, std::size_t) {
+        for (std::size_t i = next++; i < roots.size(); i = next++) {
+            unsigned int seed = 0;
+            if (i < seeds.size())
+                seed = seeds[i];
+            else if (!seeds.empty())
+                seed = seeds.back() + static_cast<unsigned int>(i - seeds.size() + 1);
+            else
+                seed = static_cast<unsigned int>(i);
+            std::mt19937 gen(seed);
+            results[i] = RunMCTS(roots[i], iterations, gen, options);
+        }
+    });
+    return results;
+}
+
 Move GetBestMoveMCTS(const Board& root, int iterations, std::mt19937& gen) {
     return GetBestMoveMCTS(root, iterations, gen, MCTSOptions{});
 }
 
 Move GetBestMoveMCTS(const Board& root, int iterations, std::mt19937& gen, const MCTSOptions& options) {
     MCTSResult res = RunMCTS(root, iterations, gen, options);
-    if (res.visits.empty()) return Move();
-    const auto* best = &res.visits[0];
-    for (const auto& p : res.visits)
-        if (p.second > best->second) best = &p;
-    return best->first;
+    const int best = SelectBestMoveIndex(res, root.GetWhiteToMove());
+    if (best < 0) return Move();
+    return res.visits[static_cast<std::size_t>(best)].first;
+}
+
+int SelectBestMoveIndex(const MCTSResult& result, bool whiteToMove) {
+    // 確定勝ちの手が複数あれば、終局までの手数が分かっている中で最短の手（詰みを先延ばしにしない）
+    int win = -1;
+    int winPlies = -1;
+    for (std::size_t i = 0; i < result.visits.size() && i < result.provenMoves.size(); i++) {
+        if (result.provenMoves[i] != winFor(whiteToMove)) continue;
+        const int plies = i < result.provenMovePlies.size() ? result.provenMovePlies[i] : -1;
+        if (win < 0 || (plies >= 0 && (winPlies < 0 || plies < winPlies))) {
+            win = static_cast<int>(i);
+            winPlies = plies;
+        }
+    }
+    if (win >= 0) return win;
+    int best = -1;
+    for (std::size_t i = 0; i < result.visits.size(); i++) {
+        const GameResult r = (i < result.provenMoves.size()) ? result.provenMoves[i] : GameResult::Ongoing;
+        // 確定負けの手は、他に手がない場合だけ選ぶ
+        const bool lost = (r == winFor(!whiteToMove));
+        if (best < 0) {
+            best = static_cast<int>(i);
+            continue;
+        }
+        const GameResult rb = (static_cast<std::size_t>(best) < result.provenMoves.size()) ? result.provenMoves[best] : GameResult::Ongoing;
+        const bool bestLost = (rb == winFor(!whiteToMove));
+        if ((bestLost && !lost) || (bestLost == lost && result.visits[i].second > result.visits[best].second))
+            best = static_cast<int>(i);
+    }
+    // Gumbel のルート探索では逐次半減で残った手を指す（確定負けなら最多訪問手に戻す）
+    const int selected = result.selectedIndex;
+    if (selected >= 0 && static_cast<std::size_t>(selected) < result.visits.size()) {
+        const GameResult r = static_cast<std::size_t>(selected) < result.provenMoves.size()
+                                 ? result.provenMoves[static_cast<std::size_t>(selected)]
+                                 : GameResult::Ongoing;
+        if (r != winFor(!whiteToMove)) return selected;
+    }
+    return best;
 }
@@ -0,0 +1,106 @@
+#include "mcts_tree.hpp"
+#include "mcts_detail.hpp"
+#include "mcts_search.hpp"
+#include <algorithm>
+
+namespace {
+    /// SelectBestMoveIndex と同じ基準: 確定勝ちの子があれば終局までが最短のもの、なければ確定負けを除いた最多訪問の子。
+    /// 全て確定負けなら終局までが最長の子（詰みまでの読み筋を最後まで出すため）
+    const MCTSNode* bestChild(const MCTSNode* n, bool whiteToMove) {
+        const MCTSNode* best = nullptr;
+        const MCTSNode* win = nullptr;
+        const MCTSNode* loss = nullptr;
+        for (const MCTSNode* c : n->children) {
+            if (c->proven == mcts_detail::winFor(whiteToMove)) {
+                if (win == nullptr || (c->provenPlies >= 0 && (win->provenPlies < 0 || c->provenPlies < win->provenPlies)))
+                    win = c;
+            } else if (mcts_detail::isProvenLoss(c, whiteToMove)) {
+                if (loss == nullptr || c->provenPlies > loss->provenPlies) loss = c;
+            } else if (c->N > 0 && (best == nullptr || c->N > best->N)) {
+                best = c;
+            }
+        }
+        if (win != nullptr) return win;
+        if (best == nullptr && n->proven == mcts_detail::winFor(!whiteToMove)) return loss;
+        return best;
+    }
+}
+
+MCTSTree::MCTSTree() {
+    reset();
+}
+
+MCTSTree::~MCTSTree() {
+    mcts_detail::deleteTree(root_);
+}
+
+void MCTSTree::reset() {
+    mcts_detail::deleteTree(root_);
+    root_ = new MCTSNode();
+    root_->parent = nullptr;
+    root_->N = 0;
+    root_->W = 0.0;
+    root_->P = 0.0;
+    nodeCount_ = 1;
+}
+
+void MCTSTree::Clear() {
+    reset();
+}
+
+bool MCTSTree::SetPosition(const Board& board) {
+    const U64 hash = board.GetZobristHash();
+    if (board.GetWhiteToMove() == rootBoard_.GetWhiteToMove()) {
+        if (hash == rootBoard_.GetZobristHash()) {
+            rootBoard_ = board;
+            return true;
+        }
+        // 値はルート手番から見た向きで木に載っているので、手番が同じになる 2 手先だけを再利用の対象にする
+        for (MCTSNode* child : root_->children) {
+            Board afterChild = rootBoard_;
+            afterChild.MakeMove(child->move_from_parent);
+            for (MCTSNode* grandchild : child->children) {
+                afterChild.MakeMove(grandchild->move_from_parent);
+                const bool match = afterChild.GetZobristHash() == hash;
+                afterChild.UnmakeMove(grandchild->move_from_parent);
+                if (!match) continue;
+                child->children.erase(std::find(child->children.begin(), child->children.end(), grandchild));
+                grandchild->parent = nullptr;
+                mcts_detail::deleteTree(root_);
+                root_ = grandchild;
+                nodeCount_ = mcts_detail::countNodes(root_);
+                rootBoard_ = board;
+                return true;
+            }
+        }
+    }
+    rootBoard_ = board;
+    reset();
+    return false;
+}
+
+MCTSResult MCTSTree::Search(int iterations, std::mt19937& gen, const MCTSOptions& options) {
+    FunctionEvaluator evaluator(options);
+    OptionsPlayout playout(options.playout);
+    return SearchMCTS(root_, nodeCount_, rootBoard_, iterations, gen, options, evaluator, playout);
+}
+
+double MCTSTree::MoveValue(const Move& move) const {
+    for (const MCTSNode* c : root_->children) {
+        if (PackMove(c->move_from_parent) == PackMove(move)) return c->N > 0 ? c->W / c->N : 0.0;
+    }
+    return 0.0;
+}
+
+std::vector<Move> MCTSTree::PrincipalVariation(int maxLength) const {
+    std::vector<Move> pv;
+    const MCTSNode* n = root_;
+    bool whiteToMove = rootBoard_.GetWhiteToMove();
+    while (static_cast<int>(pv.size()) < maxLength) {
+        n = bestChild(n, whiteToMove);
+        if (n == nullptr) break;
+        pv.push_back(n->move_from_parent);
+        whiteToMove = !whiteToMove;
+    }
+    return pv;
+}
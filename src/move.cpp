@@ -14,3 +14,33 @@ Square StrToSquare(const std::string& s) {
     if (file < 0 || file > 7 || rank < 0 || rank > 7) return A1;
     return static_cast<Square>(rank * 8 + file);
 }
+
+std::string MoveToUci(const Move& m) {
+    std::string s = SquareToStr(m.from) + SquareToStr(m.to);
+    if (m.promotionPiece != NO_PIECE) {
+        char c = 'q';
+        if (m.promotionPiece == ROOK) c = 'r';
+        else if (m.promotionPiece == BISHOP) c = 'b';
+        else if (m.promotionPiece == KNIGHT) c = 'n';
+        s += c;
+    }
+    return s;
+}
+
+int MoveToPolicyIndex(const Move& m) {
+    const int from = static_cast<int>(m.from);
+    const int to = static_cast<int>(m.to);
+    if (m.promotionPiece == NO_PIECE || m.promotionPiece == QUEEN) return from * 64 + to;
+    const int dir = (to % 8) - (from % 8) + 1;  // 0=左取り, 1=直進, 2=右取り
+    const int piece = m.promotionPiece - KNIGHT;  // N=0, B=1, R=2
+    const int color = (to < 8) ? 1 : 0;
+    return 4096 + color * 72 + ((from % 8) * 3 + dir) * 3 + piece;
+}
+
+uint16_t PackMove(const Move& m) {
+    return static_cast<uint16_t>(static_cast<int>(m.from) | (static_cast<int>(m.to) << 6) | (m.promotionPiece << 12));
+}
+
+Move UnpackMove(uint16_t handle) {
+    return Move(static_cast<Square>(handle & 63), static_cast<Square>((handle >> 6) & 63), NO_PIECE, NO_PIECE, (handle >> 12) & 7);
+}
@@ -1,8 +1,14 @@
 #include "movegen.hpp"
+#include "bitbase.hpp"
+#include "cpu_features.hpp"
 #include <algorithm>
 #include <cstdlib>
 #include <functional>
 #include <unordered_map>
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define CHESS_HAVE_PEXT 1
+#endif
 
 U64 MoveGen::whitePawnMoves[64] = {0};
 U64 MoveGen::whitePawnCaptures[64] = {0};
@@ -13,7 +19,7 @@ U64 MoveGen::bishopMoves[64] = {0};
 U64 MoveGen::knightMoves[64] = {0};
 U64 MoveGen::queenMoves[64] = {0};
 U64 MoveGen::kingMoves[64] = {0};
-bool MoveGen::initialized = false;
+std::once_flag MoveGen::initFlag;
 
 U64 MoveGen::GenerateMoves(int square, const int offsets[], int numOffsets, std::function<bool(int, int)> isValidMove) {
     U64 attacks = 0ULL;
@@ -106,6 +112,81 @@ static U64 GenerateSlidingMovesBlocked(int square, const int directions[], int n
     return attacks;
 }
 
+// 飛び駒の利き。PEXT が速い CPU（CpuFeatures::fastPext）では占有を添字に詰めて表を引き、それ以外では方向ごとに 1 マスずつ辿る。
+// どちらを使うかは Init で 1 回だけ決める
+namespace {
+    const int ROOK_DIRECTIONS[4] = {1, -1, 8, -8};
+    const int BISHOP_DIRECTIONS[4] = {9, -9, 7, -7};
+
+    struct PextTable {
+        U64 masks[64];        // 利きを遮りうるマス（盤端を除いた筋）
+        uint32_t offsets[64]; // attacks 内の各マスの先頭
+        std::vector<U64> attacks;
+    };
+
+    PextTable rookPext;
+    PextTable bishopPext;
+    bool usePext = false;
+
+    /// mask の立っているビットを下から順に詰める（表を作るときに使う PEXT の代わり）
+    uint64_t softwarePext(U64 value, U64 mask) {
+        uint64_t out = 0;
+        int k = 0;
+        for (U64 m = mask; m; m &= m - 1, k++)
+            if (value & m & (~m + 1)) out |= 1ULL << k;
+        return out;
+    }
+
+    /// square から各方向の筋のうち、最後の 1 マス（その先に遮る駒があり得ない盤端）を除いたもの
+    U64 relevantMask(int square, const int directions[4]) {
+        U64 mask = 0;
+        for (int i = 0; i < 4; i++) {
+            const U64 ray = GenerateSlidingMovesBlocked(square, &directions[i], 1, 0ULL);
+            if (!ray) continue;
+            const int last = directions[i] > 0 ? 63 - __builtin_clzll(ray) : __builtin_ctzll(ray);
+            mask |= ray & ~(1ULL << last);
+        }
+        return mask;
+    }
+
+    void buildPextTable(PextTable& table, const int directions[4]) {
+        table.attacks.clear();
+        for (int sq = 0; sq < 64; sq++) {
+            const U64 mask = relevantMask(sq, directions);
+            table.masks[sq] = mask;
+            table.offsets[sq] = static_cast<uint32_t>(table.attacks.size());
+            table.attacks.resize(table.attacks.size() + (1ULL << __builtin_popcountll(mask)));
+            // mask の部分集合を全て辿る（carry-rippler）
+            U64 occ = 0;
+            do {
+                table.attacks[table.offsets[sq] + softwarePext(occ, mask)] =
+                    GenerateSlidingMovesBlocked(sq, directions, 4, occ);
+                occ = (occ - mask) & mask;
+            } while (occ);
+        }
+    }
+
+#ifdef CHESS_HAVE_PEXT
+    __attribute__((target("bmi2"))) U64 pextAttacks(const PextTable& table, int square, U64 occupancy) {
+        return table.attacks[table.offsets[square] + _pext_u64(occupancy, table.masks[square])];
+    }
+#endif
+
+    U64 rookAttacks(int square, U64 occupancy) {
+#ifdef CHESS_HAVE_PEXT
+        if (usePext) return pextAttacks(rookPext, square, occupancy);
+#endif
+        return GenerateSlidingMovesBlocked(square, ROOK_DIRECTIONS, 4, occupancy);
+    }
+
+    U64 bishopAttacks(int square, U64 occupancy) {
+#ifdef CHESS_HAVE_PEXT
+        if (usePext) return pextAttacks(bishopPext, square, occupancy);
+#endif
+        return GenerateSlidingMovesBlocked(square, BISHOP_DIRECTIONS, 4, occupancy);
+    }
+}
+
 void MoveGen::InitKingMoves() {
     int kingOffsets[8] = {1, 9, 8, 7, -1, -9, -8, -7};
     
@@ -197,15 +278,25 @@ void MoveGen::InitQueenMoves() {
 }
 
 void MoveGen::Init() {
-    if (!initialized) {
+    std::call_once(initFlag, []() {
         InitPawnMoves();
         InitRookMoves();
         InitBishopMoves();
         InitKnightMoves();
         InitQueenMoves();
         InitKingMoves();
-        initialized = true;
-    }
+#ifdef CHESS_HAVE_PEXT
+        if (GetCpuFeatures().fastPext) {
+            buildPextTable(rookPext, ROOK_DIRECTIONS);
+            buildPextTable(bishopPext, BISHOP_DIRECTIONS);
+            usePext = true;
+        }
+#endif
+    });
+}
+
+const char* MoveGen::SliderBackend() {
+    return usePext ? "pext" : "loop";
 }
 
 U64 MoveGen::GetPawnMoves(Square square, bool isWhite) {
@@ -218,14 +309,12 @@ U64 MoveGen::GetPawnCaptures(Square square, bool isWhite) {
 
 U64 MoveGen::GetRookMoves(Square square, U64 occupancy) {
     if (occupancy == 0) return rookMoves[square];
-    int rookDirections[4] = {1, -1, 8, -8};
-    return GenerateSlidingMovesBlocked(square, rookDirections, 4, occupancy);
+    return rookAttacks(square, occupancy);
 }
 
 U64 MoveGen::GetBishopMoves(Square square, U64 occupancy) {
     if (occupancy == 0) return bishopMoves[square];
-    int bishopDirections[4] = {9, -9, 7, -7};
-    return GenerateSlidingMovesBlocked(square, bishopDirections, 4, occupancy);
+    return bishopAttacks(square, occupancy);
 }
 
 U64 MoveGen::GetKnightMoves(Square square) {
@@ -234,8 +323,7 @@ U64 MoveGen::GetKnightMoves(Square square) {
 
 U64 MoveGen::GetQueenMoves(Square square, U64 occupancy) {
     if (occupancy == 0) return queenMoves[square];
-    int queenDirections[8] = {1, -1, 8, -8, 9, -9, 7, -7};
-    return GenerateSlidingMovesBlocked(square, queenDirections, 8, occupancy);
+    return rookAttacks(square, occupancy) | bishopAttacks(square, occupancy);
 }
 
 U64 MoveGen::GetKingMoves(Square square) {
@@ -394,13 +482,17 @@ GameResult MoveGen::GetGameResult(Board& board) {
     return GameResult::Draw;
 }
 
-GameResult MoveGen::DoRandomPlayout(Board board, std::mt19937& gen) {
+GameResult MoveGen::DoRandomPlayout(Board board, std::mt19937& gen, const Bitbases* bitbases) {
     std::unordered_map<U64, int> hashCount;
     hashCount[board.GetZobristHash()] = 1;
     while (true) {
         if (board.GetHalfMoveClock() >= 100) {
             return GameResult::Draw;
         }
+        if (bitbases) {
+            const GameResult r = bitbases->Probe(board);
+            if (r != GameResult::Ongoing) return r;
+        }
         std::vector<Move> moves;
         GenerateLegalMoves(board, moves);
         if (moves.empty()) {
@@ -414,3 +506,70 @@ GameResult MoveGen::DoRandomPlayout(Board board, std::mt19937& gen) {
         }
     }
 }   
+
+U64 MoveGen::GetAttackersTo(const Board& board, Square square, U64 occupancy) {
+    const U64 diagonal = GetBishopMoves(square, occupancy);
+    const U64 straight = GetRookMoves(square, occupancy);
+    U64 attackers = 0ULL;
+    for (int c = 0; c < 2; c++) {
+        const bool white = (c == 0);
+        // 白ポーンが square に利くのは、square から黒ポーンの取る向きにあるマス
+        attackers |= GetPawnCaptures(square, !white) & board.GetPieceBitboard(PAWN, white);
+        attackers |= GetKnightMoves(square) & board.GetPieceBitboard(KNIGHT, white);
+        attackers |= GetKingMoves(square) & board.GetPieceBitboard(KING, white);
+        attackers |= diagonal & (board.GetPieceBitboard(BISHOP, white) | board.GetPieceBitboard(QUEEN, white));
+        attackers |= straight & (board.GetPieceBitboard(ROOK, white) | board.GetPieceBitboard(QUEEN, white));
+    }
+    return attackers;
+}
+
+int MoveGen::StaticExchangeEval(const Board& board, const Move& move) {
+    const int promoGain = (move.promotionPiece != NO_PIECE) ? PIECE_VALUE[move.promotionPiece] - PIECE_VALUE[PAWN] : 0;
+    int gain[32];
+    int d = 0;
+    gain[0] = PIECE_VALUE[move.capturedPiece] + promoGain;
+    // 次に取られる駒（to にいる駒）の価値
+    int onSquare = PIECE_VALUE[move.promotionPiece != NO_PIECE ? move.promotionPiece : move.pieceType];
+    U64 occupancy = board.GetAllPieces() & ~(1ULL << move.from);
+    // アンパッサンは取られるポーンが to の後ろにいる
+    if (move.pieceType == PAWN && move.capturedPiece == PAWN && move.to == board.GetEnPassantTarget())
+        occupancy &= ~(1ULL << (move.to + (board.GetWhiteToMove() ? -8 : 8)));
+    U64 attackers = GetAttackersTo(board, move.to, occupancy) & occupancy;
+    const U64 diagonalSliders = board.GetPieceBitboard(BISHOP, true) | board.GetPieceBitboard(BISHOP, false) |
+                                board.GetPieceBitboard(QUEEN, true) | board.GetPieceBitboard(QUEEN, false);
+    const U64 straightSliders = board.GetPieceBitboard(ROOK, true) | board.GetPieceBitboard(ROOK, false) |
+                                board.GetPieceBitboard(QUEEN, true) | board.GetPieceBitboard(QUEEN, false);
+    bool side = !board.GetWhiteToMove();
+    while (d < 31) {
+        const U64 own = attackers & (side ? board.GetWhitePieces() : board.GetBlackPieces());
+        if (!own) break;
+        int attackerType = NO_PIECE;
+        U64 attackerBit = 0ULL;
+        for (int pt = PAWN; pt <= KING; pt++) {
+            const U64 b = own & board.GetPieceBitboard(pt, side);
+            if (b) {
+                attackerType = pt;
+                attackerBit = b & (~b + 1);
+                break;
+            }
+        }
+        // キングは相手の利きが残るマスでは取り返せない
+        if (attackerType == KING && (attackers & ~own)) break;
+        d++;
+        gain[d] = onSquare - gain[d - 1];
+        onSquare = PIECE_VALUE[attackerType];
+        attackers &= ~attackerBit;
+        occupancy &= ~attackerBit;
+        // 取り返した駒の後ろに並んでいた飛び駒（X 線）を加える
+        if (attackerType == PAWN || attackerType == BISHOP || attackerType == QUEEN)
+            attackers |= GetBishopMoves(move.to, occupancy) & diagonalSliders & occupancy;
+        if (attackerType == ROOK || attackerType == QUEEN)
+            attackers |= GetRookMoves(move.to, occupancy) & straightSliders & occupancy;
+        side = !side;
+    }
+    while (d > 0) {
+        gain[d - 1] = -std::max(-gain[d - 1], gain[d]);
+        d--;
+    }
+    return gain[0];
+}
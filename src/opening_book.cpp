@@ -0,0 +1,220 @@
+#include "opening_book.hpp"
+#include "move.hpp"
+#include "movegen.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+    void putU16(std::string& out, uint16_t v) {
+        out.push_back(static_cast<char>(v & 0xFF));
+        out.push_back(static_cast<char>(v >> 8));
+    }
+
+    uint16_t getU16(const uint8_t* p) {
+        return static_cast<uint16_t>(p[0] | (p[1] << 8));
+    }
+
+    void putU32(std::string& out, uint32_t v) {
+        for (int i = 0; i < 4; i++) out.push_back(static_cast<char>((v >> (8 * i)) & 0xFF));
+    }
+
+    uint32_t getU32(const uint8_t* p) {
+        uint32_t v = 0;
+        for (int i = 0; i < 4; i++) v |= static_cast<uint32_t>(p[i]) << (8 * i);
+        return v;
+    }
+
+    void putU64(std::string& out, U64 v) {
+        for (int i = 0; i < 8; i++) out.push_back(static_cast<char>((v >> (8 * i)) & 0xFF));
+    }
+
+    U64 getU64(const uint8_t* p) {
+        U64 v = 0;
+        for (int i = 0; i < 8; i++) v |= static_cast<U64>(p[i]) << (8 * i);
+        return v;
+    }
+
+    void putF32(std::string& out, float f) {
+        uint32_t v;
+        std::memcpy(&v, &f, sizeof(v));
+        putU32(out, v);
+    }
+
+    float getF32(const uint8_t* p) {
+        const uint32_t v = getU32(p);
+        float f;
+        std::memcpy(&f, &v, sizeof(f));
+        return f;
+    }
+
+    GameResult toResult(uint8_t v) {
+        switch (static_cast<int8_t>(v)) {
+            case 1: return GameResult::WhiteWin;
+            case -1: return GameResult::BlackWin;
+            case 0: return GameResult::Draw;
+            default: return GameResult::Ongoing;
+        }
+    }
+}
+
+OpeningBook::OpeningBook(const std::string& path) {
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) throw std::runtime_error("cannot open opening book: " + path);
+    struct stat st;
+    if (::fstat(fd, &st) != 0) {
+        ::close(fd);
+        throw std::runtime_error("cannot stat opening book: " + path);
+    }
+    size_ = static_cast<std::size_t>(st.st_size);
+    if (size_ > 0) {
+        void* p = ::mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+        if (p == MAP_FAILED) {
+            ::close(fd);
+            throw std::runtime_error("cannot mmap opening book: " + path);
+        }
+        data_ = static_cast<const uint8_t*>(p);
+    }
+    ::close(fd);
+    if (size_ < BOOK_FILE_HEADER_SIZE || std::memcmp(data_, BOOK_MAGIC, 4) != 0 || getU32(data_ + 4) != BOOK_VERSION) {
+        if (data_) ::munmap(const_cast<uint8_t*>(data_), size_);
+        throw std::runtime_error("not an opening book: " + path);
+    }
+    count_ = static_cast<std::size_t>(getU64(data_ + 8));
+    if (count_ > (size_ - BOOK_FILE_HEADER_SIZE) / BOOK_INDEX_ENTRY_SIZE) {
+        ::munmap(const_cast<uint8_t*>(data_), size_);
+        throw std::runtime_error("truncated opening book: " + path);
+    }
+}
+
+OpeningBook::~OpeningBook() {
+    if (data_) ::munmap(const_cast<uint8_t*>(data_), size_);
+}
+
+const uint8_t* OpeningBook::find(U64 hash) const {
+    const uint8_t* index = data_ + BOOK_FILE_HEADER_SIZE;
+    std::size_t lo = 0, hi = count_;
+    while (lo < hi) {
+        const std::size_t mid = lo + (hi - lo) / 2;
+        const U64 h = getU64(index + mid * BOOK_INDEX_ENTRY_SIZE);
+        if (h < hash) {
+            lo = mid + 1;
+        } else if (h > hash) {
+            hi = mid;
+        } else {
+            const U64 offset = getU64(index + mid * BOOK_INDEX_ENTRY_SIZE + 8);
+            if (offset + BOOK_RECORD_FIXED_SIZE > size_) return nullptr;
+            const uint8_t* rec = data_ + offset;
+            if (offset + BOOK_RECORD_FIXED_SIZE + BOOK_MOVE_SIZE * getU16(rec + 9) > size_) return nullptr;
+            return rec;
+        }
+    }
+    return nullptr;
+}
+
+bool OpeningBook::Lookup(const Board& board, MCTSResult& out) const {
+    const auto start = std::chrono::steady_clock::now();
+    const uint8_t* rec = find(board.GetZobristHash());
+    if (rec == nullptr) return false;
+
+    // 保存した手は PackMove なので、駒種などを持つ合法手に置き換える。全合法手と 1 対 1 に対応しなければ使わない
+    Board copy = board;
+    std::vector<Move> moves;
+    MoveGen::GenerateLegalMoves(copy, moves);
+    const std::size_t n = getU16(rec + 9);
+    if (n != moves.size()) return false;
+
+    MCTSResult res;
+    res.rootValue = getF32(rec);
+    res.rootVisits = static_cast<int>(getU32(rec + 4));
+    res.provenResult = toResult(rec[8]);
+    const uint8_t* p = rec + BOOK_RECORD_FIXED_SIZE;
+    for (std::size_t i = 0; i < n; i++, p += BOOK_MOVE_SIZE) {
+        const uint16_t handle = getU16(p);
+        const Move* move = nullptr;
+        for (const Move& m : moves) {
+            if (PackMove(m) == handle) {
+                move = &m;
+                break;
+            }
+        }
+        if (move == nullptr) return false;
+        res.visits.push_back({*move, static_cast<int>(getU32(p + 2))});
+        res.moveValues.push_back(getF32(p + 6));
+        res.priors.push_back(getF32(p + 10));
+        res.provenMoves.push_back(toResult(p[14]));
+    }
+    res.stopReason = MCTSStopReason::Book;
+    res.elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    out = std::move(res);
+    return true;
+}
+
+bool OpeningBookWriter::Add(const Board& board, const MCTSResult& result) {
+    if (result.rootVisits <= 0 || result.visits.empty()) return false;
+    const U64 hash = board.GetZobristHash();
+    auto it = records_.find(hash);
+    if (it != records_.end() && getU32(reinterpret_cast<const uint8_t*>(it->second.data()) + 4) >=
+                                    static_cast<uint32_t>(result.rootVisits))
+        return true;
+
+    std::string rec;
+    putF32(rec, static_cast<float>(result.rootValue));
+    putU32(rec, static_cast<uint32_t>(result.rootVisits));
+    rec.push_back(static_cast<char>(static_cast<int8_t>(result.provenResult)));
+    putU16(rec, static_cast<uint16_t>(result.visits.size()));
+    for (std::size_t i = 0; i < result.visits.size(); i++) {
+        putU16(rec, PackMove(result.visits[i].first));
+        putU32(rec, static_cast<uint32_t>(result.visits[i].second));
+        putF32(rec, static_cast<float>(i < result.moveValues.size() ? result.moveValues[i] : 0.0));
+        putF32(rec, static_cast<float>(i < result.priors.size() ? result.priors[i] : 0.0));
+        const GameResult r = i < result.provenMoves.size() ? result.provenMoves[i] : GameResult::Ongoing;
+        rec.push_back(static_cast<char>(static_cast<int8_t>(r)));
+    }
+    records_[hash] = std::move(rec);
+    return true;
+}
+
+void OpeningBookWriter::Write(const std::string& path) const {
+    std::string header(BOOK_MAGIC, 4);
+    putU32(header, BOOK_VERSION);
+    putU64(header, records_.size());
+
+    // std::map なのでハッシュの昇順に並ぶ
+    std::string index;
+    U64 offset = BOOK_FILE_HEADER_SIZE + BOOK_INDEX_ENTRY_SIZE * records_.size();
+    for (const auto& r : records_) {
+        putU64(index, r.first);
+        putU64(index, offset);
+        offset += r.second.size();
+    }
+
+    const std::string tmp = path + ".tmp";
+    {
+        std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+        if (!out) throw std::runtime_error("cannot open opening book for writing: " + tmp);
+        out.write(header.data(), static_cast<std::streamsize>(header.size()));
+        out.write(index.data(), static_cast<std::streamsize>(index.size()));
+        for (const auto& r : records_) out.write(r.second.data(), static_cast<std::streamsize>(r.second.size()));
+        if (!out.flush()) throw std::runtime_error("cannot write opening book: " + tmp);
+    }
+    if (std::rename(tmp.c_str(), path.c_str()) != 0) {
+        std::remove(tmp.c_str());
+        throw std::runtime_error("cannot rename opening book to: " + path);
+    }
+}
+
+std::size_t BuildOpeningBook(const std::string& path, const std::vector<Board>& positions, int iterations,
+                             const MCTSOptions& options, const std::vector<unsigned int>& seeds, int numThreads) {
+    const std::vector<MCTSResult> results = RunMCTSMany(positions, iterations, seeds, options, numThreads);
+    OpeningBookWriter writer;
+    for (std::size_t i = 0; i < positions.size(); i++) writer.Add(positions[i], results[i]);
+    writer.Write(path);
+    return writer.Size();
+}
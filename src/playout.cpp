@@ -0,0 +1,108 @@
+#include "playout.hpp"
+#include "bitbase.hpp"
+#include "cpu_features.hpp"
+#include "movegen.hpp"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+    double resultToWhiteValue(GameResult r) {
+        if (r == GameResult::WhiteWin) return 1.0;
+        if (r == GameResult::BlackWin) return -1.0;
+        return 0.0;
+    }
+
+    /// 方針ごとの手の重み。0 の手は選ばない
+    double moveWeight(Board& board, const Move& m, const PlayoutOptions& options) {
+        const bool tactical = (m.capturedPiece != NO_PIECE || m.promotionPiece != NO_PIECE);
+        switch (options.policy) {
+            case PlayoutPolicy::Uniform:
+                return 1.0;
+            case PlayoutPolicy::CaptureBiased:
+                return tactical ? options.capture_weight : 1.0;
+            case PlayoutPolicy::CheckBiased: {
+                double w = tactical ? options.capture_weight : 1.0;
+                const bool mover = board.GetWhiteToMove();
+                board.MakeMove(m);
+                if (board.IsInCheck(!mover)) w *= options.check_weight;
+                board.UnmakeMove(m);
+                return w;
+            }
+            case PlayoutPolicy::SEEFiltered: {
+                if (!tactical) return 1.0;
+                const int see = MoveGen::StaticExchangeEval(board, m);
+                if (see < 0) return 0.0;
+                return see > 0 ? options.capture_weight : 1.0;
+            }
+        }
+        return 1.0;
+    }
+}
+
+CHESS_CLONES_POPCNT int MaterialBalance(const Board& board) {
+    int score = 0;
+    for (int pt = PAWN; pt < KING; pt++) {
+        score += PIECE_VALUE[pt] * __builtin_popcountll(board.GetPieceBitboard(pt, true));
+        score -= PIECE_VALUE[pt] * __builtin_popcountll(board.GetPieceBitboard(pt, false));
+    }
+    return score;
+}
+
+std::vector<double> SEEPriors(const Board& board, const std::vector<Move>& moves, double scale) {
+    std::vector<double> priors(moves.size());
+    double total = 0.0;
+    for (std::size_t i = 0; i < moves.size(); i++) {
+        priors[i] = std::exp(MoveGen::StaticExchangeEval(board, moves[i]) / scale);
+        total += priors[i];
+    }
+    for (double& p : priors) p /= total;
+    return priors;
+}
+
+double RunPlayout(Board board, std::mt19937& gen, const PlayoutOptions& options) {
+    std::unordered_map<U64, int> hashCount;
+    hashCount[board.GetZobristHash()] = 1;
+    std::vector<Move> moves;
+    std::vector<double> weights;
+    for (int ply = 0;; ply++) {
+        if (board.GetHalfMoveClock() >= 100) return 0.0;
+        if (options.bitbases) {
+            const GameResult r = options.bitbases->Probe(board);
+            if (r != GameResult::Ongoing) return resultToWhiteValue(r);
+        }
+        if (options.max_plies > 0 && ply >= options.max_plies)
+            return std::tanh(MaterialBalance(board) / options.eval_scale);
+        MoveGen::GenerateLegalMoves(board, moves);
+        if (moves.empty()) return resultToWhiteValue(MoveGen::GetGameResult(board));
+
+        std::size_t pick;
+        if (options.policy == PlayoutPolicy::Uniform) {
+            std::uniform_int_distribution<std::size_t> dist(0, moves.size() - 1);
+            pick = dist(gen);
+        } else {
+            weights.resize(moves.size());
+            double total = 0.0;
+            for (std::size_t i = 0; i < moves.size(); i++) {
+                weights[i] = moveWeight(board, moves[i], options);
+                total += weights[i];
+            }
+            // 全ての手が除外されたら一様に戻す
+            if (total <= 0.0) std::fill(weights.begin(), weights.end(), 1.0);
+            std::discrete_distribution<std::size_t> dist(weights.begin(), weights.end());
+            pick = dist(gen);
+        }
+        board.MakeMove(moves[pick]);
+        if (++hashCount[board.GetZobristHash()] >= 3) return 0.0;
+    }
+}
+
+PlayoutPolicy PlayoutPolicyFromString(const std::string& name) {
+    if (name == "uniform") return PlayoutPolicy::Uniform;
+    if (name == "capture") return PlayoutPolicy::CaptureBiased;
+    if (name == "check") return PlayoutPolicy::CheckBiased;
+    if (name == "see") return PlayoutPolicy::SEEFiltered;
+    throw std::invalid_argument("unknown playout policy: " + name);
+}
@@ -1,24 +1,36 @@
+#include "bitbase.hpp"
 #include "board.hpp"
 #include "movegen.hpp"
 #include "move.hpp"
 #include "mcts.hpp"
+#include "eval_cache.hpp"
+#include "selfplay.hpp"
+#include "encoding.hpp"
+#include "training_data.hpp"
+#include "playout.hpp"
+#include "board_batch.hpp"
+#include "tracer.hpp"
+#include "cpu_features.hpp"
+#include "opening_book.hpp"
 #include <pybind11/pybind11.h>
+#include <pybind11/numpy.h>
 #include <pybind11/stl.h>
+#include <functional>
 #include <random>
 #include <stdexcept>
 
 namespace py = pybind11;
 
 static std::string move_to_uci(const Move& m) {
-    std::string s = SquareToStr(m.from) + SquareToStr(m.to);
-    if (m.promotionPiece != NO_PIECE) {
-        char c = 'q';
-        if (m.promotionPiece == ROOK) c = 'r';
-        else if (m.promotionPiece == BISHOP) c = 'b';
-        else if (m.promotionPiece == KNIGHT) c = 'n';
-        s += c;
-    }
-    return s;
+    return MoveToUci(m);
+}
+
+/// 確定結果を手番側から見た "win" / "loss" / "draw"（未確定は None）に変換
+static py::object proven_to_py(GameResult r, bool whiteToMove) {
+    if (r == GameResult::Ongoing) return py::none();
+    if (r == GameResult::Draw) return py::str("draw");
+    const bool whiteWins = (r == GameResult::WhiteWin);
+    return py::str(whiteWins == whiteToMove ? "win" : "loss");
 }
 
 static Move find_move_from_uci(const std::vector<Move>& moves, const std::string& uci) {
@@ -28,6 +40,288 @@ static Move find_move_from_uci(const std::vector<Move>& moves, const std::string
     throw std::invalid_argument("move not legal: " + uci);
 }
 
+/// GIL を取る。tracer があれば取れるまで待った区間を "gil_wait" として記録する
+class TracedGilAcquire {
+public:
+    explicit TracedGilAcquire(Tracer* tracer) : start_(tracer ? tracer->Now() : 0.0), acquire_() {
+        if (tracer) tracer->Record("gil_wait", start_, tracer->Now());
+    }
+
+private:
+    double start_;
+    py::gil_scoped_acquire acquire_;
+};
+
+/// Python の batch_eval(fen_list, uci_list_per_fen) -> (prior_list, value_list) を C++ のバッチ評価関数に包む。
+/// tracer があれば GIL 待ち・Python オブジェクトへの変換・Python 側の呼び出しの区間を記録する
+static std::function<BatchEvalResult(const std::vector<std::string>&, const std::vector<std::vector<std::string>>&)>
+make_batch_eval_fn(py::object batch_eval, Tracer* tracer = nullptr) {
+    return [batch_eval, tracer](const std::vector<std::string>& fens,
+                                const std::vector<std::vector<std::string>>& uci_list_per_fen) {
+        TracedGilAcquire acquire(tracer);
+        py::list py_fens;
+        py::list py_uci_lists;
+        {
+            TraceSpan span(tracer, "to_python");
+            for (const auto& f : fens) py_fens.append(py::cast(f));
+            for (const auto& u : uci_list_per_fen) py_uci_lists.append(py::cast(u));
+        }
+        py::object result;
+        {
+            TraceSpan span(tracer, "python_call");
+            result = batch_eval(py_fens, py_uci_lists);
+        }
+        TraceSpan span(tracer, "from_python");
+        BatchEvalResult out;
+        py::tuple t = result.cast<py::tuple>();
+        if (t.size() < 2) return out;
+        py::object prior_list = t[0];
+        py::object value_list = t[1];
+        for (py::handle h : prior_list) {
+            out.priors.push_back(h.cast<std::vector<double>>());
+        }
+        out.values = value_list.cast<std::vector<double>>();
+        return out;
+    };
+}
+
+/// Python の batch_arrays(planes, move_indices, move_offsets, priors, values) を配列渡しのバッチ評価関数に包む。
+/// どの配列も C++ 側のバッファをコピーせずに見せたもので、呼び出しの間だけ有効
+static std::function<void(BatchEvalArrays&)> make_batch_array_fn(py::object batch_arrays, Tracer* tracer = nullptr) {
+    return [batch_arrays, tracer](BatchEvalArrays& a) {
+        TracedGilAcquire acquire(tracer);
+        const py::ssize_t n = static_cast<py::ssize_t>(a.n);
+        const py::ssize_t numMoves = static_cast<py::ssize_t>(a.moveOffsets[a.n]);
+        // base を渡すと pybind11 はデータをコピーせずにポインタをそのまま使う
+        const py::none base;
+        py::array_t<float> planes(std::vector<py::ssize_t>{n, INPUT_PLANES, 8, 8}, a.planes, base);
+        py::array_t<int32_t> moveIndices(std::vector<py::ssize_t>{numMoves}, a.moveIndices, base);
+        py::array_t<int32_t> moveOffsets(std::vector<py::ssize_t>{n + 1}, a.moveOffsets, base);
+        py::array_t<float> priors(std::vector<py::ssize_t>{n, POLICY_SIZE}, a.priors, base);
+        py::array_t<float> values(std::vector<py::ssize_t>{n}, a.values, base);
+        TraceSpan span(tracer, "python_call");
+        batch_arrays(planes, moveIndices, moveOffsets, priors, values);
+    };
+}
+
+/// run_mcts / run_mcts_many / build_opening_book が **kwargs で受け取る探索オプションの説明。各関数の docstring に連結する
+static const char* const SEARCH_KWARGS_DOC =
+    "Search keyword arguments (shared by run_mcts, run_mcts_many and build_opening_book; unknown names raise TypeError): "
+    "prior(fen, uci_list) -> list[float] and value(fen) -> float evaluate single positions; "
+    "batch_eval(fen_list, uci_list_per_fen) -> (prior_list, value_list) is the batched form for PVNN (single inference), "
+    "batch_prior/batch_value the batched form with separate calls. "
+    "batch_arrays(planes, move_indices, move_offsets, priors, values) is the array form (takes precedence): planes "
+    "float32 (B, INPUT_PLANES, 8, 8), move_indices int32 policy indices of all legal moves concatenated, move_offsets "
+    "int32 (B+1,); the callback writes priors float32 (B, POLICY_SIZE) and values float32 (B,) in place. "
+    "The arrays are views of C++ buffers valid only during the call. batch_size (default 32) caps the leaves per batch. "
+    "dirichlet_alpha>0 adds Dirichlet noise at root (e.g. 0.3); dirichlet_epsilon mixes with prior (default 0.25). "
+    "pfu_scale>0 enables PFU (unvisited node initial value = parent_value - pfu_scale/sqrt(parent_N), clipped). "
+    "cache: optional EvalCache shared across calls; evaluator results are looked up by Zobrist hash before calling value/batch callbacks. "
+    "time_limit_ms / node_limit bound the search in addition to iterations (0 = off); memory_limit_bytes>0 caps the "
+    "tree memory by collapsing the least-visited expanded subtrees (keeping their visit statistics) instead of stopping; smart_pruning stops once the "
+    "most-visited root move can no longer be overtaken; convergence_kld>0 stops when the root visit distribution settles. "
+    "pipeline_depth>=2 (batch mode) evaluates batches on a separate thread while the next batch is gathered. "
+    "max_collisions (default 64) caps how many times per batch a worker may hit a leaf already pending evaluation and retry from the root. "
+    "solver=True propagates proven wins/losses/draws up the tree and stops once the root is proven (off by default because it changes the visit distribution). "
+    "book: optional OpeningBook; if the root is stored with at least iterations visits (or proven) the stored result "
+    "is returned with stop_reason 'book', otherwise the search starts from the stored root statistics and adds the "
+    "remaining visits. "
+    "bitbases: optional Bitbases; non-root positions found in a table become proven nodes and playouts stop there. "
+    "value='static' uses the built-in incrementally updated material+PST evaluator instead of a callback. "
+    "prior='see' uses built-in priors proportional to exp(SEE/200) (static exchange evaluation in centipawns), "
+    "favouring winning captures and demoting moves that hang a piece. "
+    "gumbel=True replaces PUCT and Dirichlet noise at the root with Gumbel MuZero search: the top gumbel_top_k (default 16) moves by "
+    "log(prior) + Gumbel noise (<=0 = all moves) are narrowed by sequential halving on g + log(prior) + sigma(q), "
+    "and the survivor is played (best_move) even if another move has more visits. "
+    "Without value/batch callbacks, leaves are valued by playouts: playout='uniform'|'capture'|'check'|'see' selects the move "
+    "policy, and playout_max_plies>0 cuts playouts short and scores them by material balance. "
+    "collect_stats=True measures the per-phase wall time in info['stats']; tracer: optional Tracer recording the batch "
+    "pipeline and callback spans.";
+
+/// run_mcts / run_mcts_many / build_opening_book 共通の探索オプションを **kwargs から組み立てる。
+/// 引数名と既定値（MCTSOptions の既定値）はここだけに書き、知らない名前と excluded の名前は TypeError にする。
+/// Python コールバックは呼び出しごとに GIL を取り直す
+static MCTSOptions make_mcts_options(const py::kwargs& kwargs, std::initializer_list<const char*> excluded = {}) {
+    py::object prior = py::none(), value = py::none(), batch_eval = py::none(), batch_prior = py::none(),
+               batch_value = py::none(), batch_arrays = py::none();
+    MCTSOptions opts;
+    for (auto item : kwargs) {
+        const std::string name = item.first.cast<std::string>();
+        const py::handle v = item.second;
+        for (const char* e : excluded)
+            if (name == e) throw py::type_error("unexpected keyword argument '" + name + "'");
+        if (name == "prior") prior = py::reinterpret_borrow<py::object>(v);
+        else if (name == "value") value = py::reinterpret_borrow<py::object>(v);
+        else if (name == "batch_eval") batch_eval = py::reinterpret_borrow<py::object>(v);
+        else if (name == "batch_prior") batch_prior = py::reinterpret_borrow<py::object>(v);
+        else if (name == "batch_value") batch_value = py::reinterpret_borrow<py::object>(v);
+        else if (name == "batch_arrays") batch_arrays = py::reinterpret_borrow<py::object>(v);
+        else if (name == "batch_size") opts.batch_size = std::max(1, std::min(v.cast<int>(), 1024));
+        else if (name == "dirichlet_alpha") opts.dirichlet_alpha = v.cast<double>();
+        else if (name == "dirichlet_epsilon") opts.dirichlet_epsilon = v.cast<double>();
+        else if (name == "pfu_scale") opts.pfu_scale = v.cast<double>();
+        else if (name == "cache") opts.eval_cache = v.is_none() ? nullptr : v.cast<EvalCache*>();
+        else if (name == "time_limit_ms") opts.time_limit_ms = v.cast<double>();
+        else if (name == "node_limit") opts.node_limit = v.cast<int>();
+        else if (name == "smart_pruning") opts.smart_pruning = v.cast<bool>();
+        else if (name == "convergence_kld") opts.convergence_kld = v.cast<double>();
+        else if (name == "pipeline_depth") opts.pipeline_depth = std::max(1, v.cast<int>());
+        else if (name == "max_collisions") opts.max_collisions = std::max(0, v.cast<int>());
+        else if (name == "solver") opts.solver = v.cast<bool>();
+        else if (name == "playout") opts.playout.policy = PlayoutPolicyFromString(v.cast<std::string>());
+        else if (name == "playout_max_plies") opts.playout.max_plies = std::max(0, v.cast<int>());
+        else if (name == "collect_stats") opts.collect_stats = v.cast<bool>();
+        else if (name == "tracer") opts.tracer = v.is_none() ? nullptr : v.cast<Tracer*>();
+        else if (name == "memory_limit_bytes") opts.memory_limit_bytes = v.cast<std::size_t>();
+        else if (name == "book") opts.book = v.is_none() ? nullptr : v.cast<OpeningBook*>();
+        else if (name == "bitbases") opts.bitbases = opts.playout.bitbases = v.is_none() ? nullptr : v.cast<Bitbases*>();
+        else if (name == "gumbel") opts.gumbel = v.cast<bool>();
+        else if (name == "gumbel_top_k") opts.gumbel_top_k = v.cast<int>();
+        else throw py::type_error("unexpected keyword argument '" + name + "'");
+    }
+
+    bool use_batch_eval = (!batch_eval.is_none() && py::hasattr(batch_eval, "__call__"));
+    bool use_batch_split = (!batch_prior.is_none() && py::hasattr(batch_prior, "__call__") &&
+                           !batch_value.is_none() && py::hasattr(batch_value, "__call__"));
+    bool use_batch_arrays = (!batch_arrays.is_none() && py::hasattr(batch_arrays, "__call__"));
+    bool use_batch = use_batch_arrays || use_batch_eval || use_batch_split;
+
+    if (use_batch_arrays) {
+        opts.batch_array_fn = make_batch_array_fn(batch_arrays, opts.tracer);
+    } else if (use_batch_eval) {
+        opts.batch_eval_fn = make_batch_eval_fn(batch_eval, opts.tracer);
+    } else if (use_batch_split) {
+        opts.batch_prior_fn = [batch_prior](const std::vector<std::string>& fens,
+                                             const std::vector<std::vector<std::string>>& uci_list_per_fen) {
+            py::gil_scoped_acquire acquire;
+            py::list py_fens;
+            for (const auto& f : fens) py_fens.append(py::cast(f));
+            py::list py_uci_lists;
+            for (const auto& u : uci_list_per_fen) py_uci_lists.append(py::cast(u));
+            py::object result = batch_prior(py_fens, py_uci_lists);
+            std::vector<std::vector<double>> out;
+            for (py::handle h : result) {
+                out.push_back(h.cast<std::vector<double>>());
+            }
+            return out;
+        };
+        opts.batch_value_fn = [batch_value](const std::vector<std::string>& fens) {
+            py::gil_scoped_acquire acquire;
+            py::list py_fens;
+            for (const auto& f : fens) py_fens.append(py::cast(f));
+            py::object result = batch_value(py_fens);
+            return result.cast<std::vector<double>>();
+        };
+    }
+    if (!use_batch) {
+        if (py::isinstance<py::str>(prior)) {
+            if (prior.cast<std::string>() != "see")
+                throw std::invalid_argument("prior must be a callable or \"see\"");
+            opts.see_prior = true;
+        } else if (!prior.is_none() && py::hasattr(prior, "__call__")) {
+            opts.prior_fn = [prior](const Board& board, const std::vector<Move>& moves) {
+                py::gil_scoped_acquire acquire;
+                std::string fen = board.GetFen();
+                std::vector<std::string> uci;
+                uci.reserve(moves.size());
+                for (const Move& m : moves) uci.push_back(move_to_uci(m));
+                py::object result = prior(py::cast(fen), py::cast(uci));
+                return result.cast<std::vector<double>>();
+            };
+        }
+        if (py::isinstance<py::str>(value)) {
+            if (value.cast<std::string>() != "static")
+                throw std::invalid_argument("value must be a callable or \"static\"");
+            opts.static_eval = true;
+        } else if (!value.is_none() && py::hasattr(value, "__call__")) {
+            opts.value_fn = [value](const Board& board) {
+                py::gil_scoped_acquire acquire;
+                py::object result = value(py::cast(board.GetFen()));
+                return result.cast<double>();
+            };
+        }
+    }
+    return opts;
+}
+
+/// vector の中身をコピーせずに 1 次元 numpy 配列として渡す（配列が vector の所有権を持つ）
+template <class T>
+static py::array_t<T> vector_to_numpy(std::vector<T>&& v) {
+    auto* owned = new std::vector<T>(std::move(v));
+    py::capsule owner(owned, [](void* p) { delete static_cast<std::vector<T>*>(p); });
+    return py::array_t<T>(static_cast<py::ssize_t>(owned->size()), owned->data(), owner);
+}
+
+static py::dict stats_to_py(const MCTSStats& st) {
+    py::dict d;
+    d["nodes_created"] = st.nodesCreated;
+    d["max_depth"] = st.maxDepth;
+    d["avg_depth"] = st.avgDepth;
+    d["select_ms"] = st.selectMs;
+    d["expand_ms"] = st.expandMs;
+    d["eval_ms"] = st.evalMs;
+    d["backup_ms"] = st.backupMs;
+    d["eval_calls"] = st.evalCalls;
+    d["eval_positions"] = st.evalPositions;
+    d["avg_batch_fill"] = st.avgBatchFill;
+    d["min_batch_fill"] = st.minBatchFill;
+    d["collisions"] = st.collisions;
+    d["dedup_hits"] = st.dedupHits;
+    d["cache_hits"] = st.cacheHits;
+    d["nodes_pruned"] = st.nodesPruned;
+    d["bitbase_hits"] = st.bitbaseHits;
+    d["tree_bytes"] = st.treeBytes;
+    return d;
+}
+
+/// 探索結果を (uci_list, visits, root_value, root_visits[, info]) に変換する。
+/// as_arrays なら (moves, visits, priors, root_value, root_visits[, info]) で、moves は PackMove の uint16 配列
+static py::tuple mcts_result_to_py(const MCTSResult& res, bool white, bool return_info, bool as_arrays) {
+    const int best = SelectBestMoveIndex(res, white);
+    py::dict info;
+    if (return_info) {
+        info["stop_reason"] = StopReasonToString(res.stopReason);
+        info["elapsed_ms"] = res.elapsedMs;
+        info["proven"] = proven_to_py(res.provenResult, white);
+        info["stats"] = stats_to_py(res.stats);
+    }
+    if (as_arrays) {
+        std::vector<uint16_t> moves;
+        std::vector<int32_t> visits;
+        std::vector<float> priors(res.priors.begin(), res.priors.end());
+        moves.reserve(res.visits.size());
+        visits.reserve(res.visits.size());
+        for (const auto& p : res.visits) {
+            moves.push_back(PackMove(p.first));
+            visits.push_back(p.second);
+        }
+        py::array_t<uint16_t> moveArr = vector_to_numpy(std::move(moves));
+        py::array_t<int32_t> visitArr = vector_to_numpy(std::move(visits));
+        py::array_t<float> priorArr = vector_to_numpy(std::move(priors));
+        if (!return_info)
+            return py::make_tuple(moveArr, visitArr, priorArr, res.rootValue, res.rootVisits);
+        if (!res.improvedPolicy.empty())
+            info["improved_policy"] =
+                vector_to_numpy(std::vector<float>(res.improvedPolicy.begin(), res.improvedPolicy.end()));
+        info["best_move"] = best >= 0 ? py::object(py::int_(PackMove(res.visits[static_cast<std::size_t>(best)].first)))
+                                      : py::object(py::none());
+        return py::make_tuple(moveArr, visitArr, priorArr, res.rootValue, res.rootVisits, info);
+    }
+    std::vector<std::string> uci_list;
+    std::vector<int> visits;
+    uci_list.reserve(res.visits.size());
+    visits.reserve(res.visits.size());
+    for (const auto& p : res.visits) {
+        uci_list.push_back(move_to_uci(p.first));
+        visits.push_back(p.second);
+    }
+    if (!return_info)
+        return py::make_tuple(uci_list, visits, res.rootValue, res.rootVisits);
+    if (!res.improvedPolicy.empty()) info["improved_policy"] = res.improvedPolicy;
+    info["best_move"] = best >= 0 ? py::object(py::str(uci_list[static_cast<std::size_t>(best)])) : py::object(py::none());
+    return py::make_tuple(uci_list, visits, res.rootValue, res.rootVisits, info);
+}
+
 struct BoardWrapper {
     Board board_;
     std::vector<Move> move_history_;
@@ -54,6 +348,29 @@ struct BoardWrapper {
         move_history_.push_back(m);
     }
 
+    /// 合法手を PackMove のハンドルで返す（legal_moves と同順）
+    py::array_t<uint16_t> legal_move_handles() {
+        std::vector<Move> moves;
+        MoveGen::GenerateLegalMoves(board_, moves);
+        std::vector<uint16_t> handles;
+        handles.reserve(moves.size());
+        for (const Move& m : moves) handles.push_back(PackMove(m));
+        return vector_to_numpy(std::move(handles));
+    }
+
+    void push_move(int handle) {
+        std::vector<Move> moves;
+        MoveGen::GenerateLegalMoves(board_, moves);
+        for (const Move& m : moves) {
+            if (PackMove(m) == handle) {
+                board_.MakeMove(m);
+                move_history_.push_back(m);
+                return;
+            }
+        }
+        throw std::invalid_argument("move handle not legal: " + std::to_string(handle));
+    }
+
     void pop() {
         if (move_history_.empty()) throw std::runtime_error("no move to undo");
         Move m = move_history_.back();
@@ -69,6 +386,12 @@ struct BoardWrapper {
         return 2;  // Ongoing
     }
 
+    int see(const std::string& uci) {
+        std::vector<Move> moves;
+        MoveGen::GenerateLegalMoves(board_, moves);
+        return MoveGen::StaticExchangeEval(board_, find_move_from_uci(moves, uci));
+    }
+
     bool white_to_move() const { return board_.GetWhiteToMove(); }
 
     std::string fen() const { return board_.GetFen(); }
@@ -79,107 +402,379 @@ struct BoardWrapper {
 PYBIND11_MODULE(chess_engine, m) {
     m.doc() = "Chess engine with MCTS (pybind11 binding)";
 
+    m.def("move_handle_to_uci", [](int handle) { return MoveToUci(UnpackMove(static_cast<uint16_t>(handle))); },
+          py::arg("handle"), "UCI string of a move handle.");
+    m.def("policy_indices", [](py::array_t<uint16_t, py::array::c_style | py::array::forcecast> handles) {
+        std::vector<int32_t> out(static_cast<std::size_t>(handles.size()));
+        const uint16_t* h = handles.data();
+        for (std::size_t i = 0; i < out.size(); i++) out[i] = MoveToPolicyIndex(UnpackMove(h[i]));
+        return vector_to_numpy(std::move(out));
+    }, py::arg("handles"), "Map move handles to policy indices in [0, POLICY_SIZE) as an int32 numpy array.");
+
     m.def("init", &MoveGen::Init, "Initialize move generator tables. Call once before using Board or run_mcts.");
+    // 飛び駒の利きの実装（PEXT かどうか）は import 時に 1 回だけ決める。init() は何度呼んでもよい
+    MoveGen::Init();
+    m.def("cpu_features", []() {
+        const CpuFeatures& f = GetCpuFeatures();
+        py::dict d;
+        d["popcnt"] = f.popcnt;
+        d["bmi2"] = f.bmi2;
+        d["avx2"] = f.avx2;
+        d["fast_pext"] = f.fastPext;
+        d["slider_attacks"] = MoveGen::SliderBackend();
+        return d;
+    }, "CPU extensions detected at import and the slider-attack kernel in use ('pext' with BMI2 where PEXT is fast, else 'loop'; "
+       "AMD Zen2 and earlier microcode PEXT and use 'loop'). "
+       "Set CHESS_ENGINE_ISA=generic before import to force the portable kernels.");
 
-    m.def("run_mcts", [](BoardWrapper& bw, int iterations, unsigned int seed,
-                         py::object prior, py::object value,
-                         py::object batch_eval, py::object batch_prior, py::object batch_value, int batch_size,
-                         double dirichlet_alpha, double dirichlet_epsilon, double pfu_scale) {
+    // 探索オプションは make_mcts_options が **kwargs から読む（引数名・既定値・説明は SEARCH_KWARGS_DOC と合わせて 1 か所）
+    static const std::string runMctsDoc = std::string(
+        "Run MCTS from board for iterations simulations. "
+        "Returns (uci_list, visits, root_value, root_visits); with return_info=True a fifth element dict "
+        "{stop_reason, elapsed_ms, proven, best_move, stats[, improved_policy]} is appended; improved_policy (gumbel only) "
+        "is softmax(log(prior) + sigma(q)) in the order of the moves, a policy training target for small simulation budgets. "
+        "stats is a dict of search counters "
+        "(nodes_created, max_depth, avg_depth, eval_calls, eval_positions, avg_batch_fill, min_batch_fill, collisions, "
+        "dedup_hits, cache_hits, nodes_pruned, bitbase_hits, tree_bytes) and per-phase wall time (select_ms, expand_ms, eval_ms, backup_ms; measured only with "
+        "collect_stats=True, otherwise 0). "
+        "as_arrays=True returns (moves, visits, priors, root_value, root_visits[, info]) as numpy arrays without copying: "
+        "moves are uint16 move handles (see Board.push_move), visits int32, priors float32 root priors; best_move is then a handle "
+        "and improved_policy a float32 array. ") + SEARCH_KWARGS_DOC;
+    m.def("run_mcts", [](BoardWrapper& bw, int iterations, unsigned int seed, bool return_info, bool as_arrays,
+                         const py::kwargs& kwargs) {
         std::mt19937 gen(seed);
-        MCTSOptions opts;
-        opts.batch_size = std::max(1, std::min(batch_size, 1024));
-        opts.dirichlet_alpha = dirichlet_alpha;
-        opts.dirichlet_epsilon = dirichlet_epsilon;
-        opts.pfu_scale = pfu_scale;
-
-        bool use_batch_eval = (!batch_eval.is_none() && py::hasattr(batch_eval, "__call__"));
-        bool use_batch_split = (!batch_prior.is_none() && py::hasattr(batch_prior, "__call__") &&
-                               !batch_value.is_none() && py::hasattr(batch_value, "__call__"));
-        bool use_batch = use_batch_eval || use_batch_split;
-
-        if (use_batch_eval) {
-            opts.batch_eval_fn = [batch_eval](const std::vector<std::string>& fens,
-                                              const std::vector<std::vector<std::string>>& uci_list_per_fen) {
-                py::gil_scoped_acquire acquire;
-                py::list py_fens;
-                for (const auto& f : fens) py_fens.append(py::cast(f));
-                py::list py_uci_lists;
-                for (const auto& u : uci_list_per_fen) py_uci_lists.append(py::cast(u));
-                py::object result = batch_eval(py_fens, py_uci_lists);
-                BatchEvalResult out;
-                py::tuple t = result.cast<py::tuple>();
-                if (t.size() < 2) return out;
-                py::object prior_list = t[0];
-                py::object value_list = t[1];
-                for (py::handle h : prior_list) {
-                    out.priors.push_back(h.cast<std::vector<double>>());
-                }
-                out.values = value_list.cast<std::vector<double>>();
-                return out;
-            };
-        } else if (use_batch_split) {
-            opts.batch_prior_fn = [batch_prior](const std::vector<std::string>& fens,
-                                                 const std::vector<std::vector<std::string>>& uci_list_per_fen) {
-                py::gil_scoped_acquire acquire;
-                py::list py_fens;
-                for (const auto& f : fens) py_fens.append(py::cast(f));
-                py::list py_uci_lists;
-                for (const auto& u : uci_list_per_fen) py_uci_lists.append(py::cast(u));
-                py::object result = batch_prior(py_fens, py_uci_lists);
-                std::vector<std::vector<double>> out;
-                for (py::handle h : result) {
-                    out.push_back(h.cast<std::vector<double>>());
-                }
-                return out;
-            };
-            opts.batch_value_fn = [batch_value](const std::vector<std::string>& fens) {
-                py::gil_scoped_acquire acquire;
-                py::list py_fens;
-                for (const auto& f : fens) py_fens.append(py::cast(f));
-                py::object result = batch_value(py_fens);
-                return result.cast<std::vector<double>>();
-            };
+        const MCTSOptions opts = make_mcts_options(kwargs);
+
+        // コールバックは各自 GIL を取り直すので、探索中は GIL を解放する（パイプライン時は評価スレッドが GIL を取る）
+        const Board root = bw.board_;
+        MCTSResult res;
+        {
+            py::gil_scoped_release release;
+            res = RunMCTS(root, iterations, gen, opts);
         }
-        if (!use_batch) {
-            if (!prior.is_none() && py::hasattr(prior, "__call__")) {
-                opts.prior_fn = [prior](const Board& board, const std::vector<Move>& moves) {
-                    py::gil_scoped_acquire acquire;
-                    std::string fen = board.GetFen();
-                    std::vector<std::string> uci;
-                    uci.reserve(moves.size());
-                    for (const Move& m : moves) uci.push_back(move_to_uci(m));
-                    py::object result = prior(py::cast(fen), py::cast(uci));
-                    return result.cast<std::vector<double>>();
-                };
-            }
-            if (!value.is_none() && py::hasattr(value, "__call__")) {
-                opts.value_fn = [value](const Board& board) {
-                    py::gil_scoped_acquire acquire;
-                    py::object result = value(py::cast(board.GetFen()));
-                    return result.cast<double>();
-                };
-            }
+        return mcts_result_to_py(res, root.GetWhiteToMove(), return_info, as_arrays);
+    }, py::arg("board"), py::arg("iterations"), py::arg("seed"), py::kw_only(),
+       py::arg("return_info") = false, py::arg("as_arrays") = false, runMctsDoc.c_str());
+
+    static const std::string runMctsManyDoc = std::string(
+        "Search many independent roots in parallel on a C++ thread pool with the GIL released. "
+        "seeds (same length as boards) defaults to 0, 1, 2, ...; threads<=0 uses every hardware thread. "
+        "return_info, as_arrays and the search keyword arguments are as in run_mcts and apply to every root; Python "
+        "callbacks are called from worker threads (each call holds the GIL) and a shared cache is used concurrently. "
+        "Returns a list of run_mcts results in the order of boards. ") + SEARCH_KWARGS_DOC;
+    m.def("run_mcts_many", [](const std::vector<BoardWrapper*>& boards, int iterations, py::object seeds, int threads,
+                              bool return_info, bool as_arrays, const py::kwargs& kwargs) {
+        std::vector<unsigned int> seedList;
+        if (!seeds.is_none()) seedList = seeds.cast<std::vector<unsigned int>>();
+        if (!seedList.empty() && seedList.size() != boards.size())
+            throw std::invalid_argument("seeds must have the same length as boards");
+        const MCTSOptions opts = make_mcts_options(kwargs);
+
+        std::vector<Board> roots;
+        roots.reserve(boards.size());
+        for (const BoardWrapper* bw : boards) {
+            if (bw == nullptr) throw std::invalid_argument("boards must not contain None");
+            roots.push_back(bw->board_);
+        }
+        // 各ルートの探索は C++ のスレッドプールで走り、コールバックだけが GIL を取る
+        std::vector<MCTSResult> results;
+        {
+            py::gil_scoped_release release;
+            results = RunMCTSMany(roots, iterations, seedList, opts, threads);
         }
+        py::list out;
+        for (std::size_t i = 0; i < results.size(); i++)
+            out.append(mcts_result_to_py(results[i], roots[i].GetWhiteToMove(), return_info, as_arrays));
+        return out;
+    }, py::arg("boards"), py::arg("iterations"), py::arg("seeds") = py::none(), py::arg("threads") = 0, py::kw_only(),
+       py::arg("return_info") = false, py::arg("as_arrays") = false, runMctsManyDoc.c_str());
 
-        MCTSResult res = RunMCTS(bw.board_, iterations, gen, opts);
-        std::vector<std::string> uci_list;
-        std::vector<int> visits;
-        uci_list.reserve(res.visits.size());
-        visits.reserve(res.visits.size());
-        for (const auto& p : res.visits) {
-            uci_list.push_back(move_to_uci(p.first));
-            visits.push_back(p.second);
+    static const std::string buildOpeningBookDoc = std::string(
+        "Search every board as in run_mcts_many (in parallel, GIL released) and write the root visit distributions, "
+        "move values and priors to an opening book file keyed by Zobrist hash. The file is written to path + '.tmp' and "
+        "renamed, so processes that have the old book open keep reading it. Returns the number of positions stored "
+        "(terminal positions are skipped). The search keyword arguments are as in run_mcts except solver, which is "
+        "always on so that proven results are stored, and book. ") + SEARCH_KWARGS_DOC;
+    m.def("build_opening_book", [](const std::string& path, const std::vector<BoardWrapper*>& boards, int iterations,
+                                   py::object seeds, int threads, const py::kwargs& kwargs) {
+        std::vector<unsigned int> seedList;
+        if (!seeds.is_none()) seedList = seeds.cast<std::vector<unsigned int>>();
+        MCTSOptions opts = make_mcts_options(kwargs, {"solver", "book"});
+        opts.solver = true;
+        std::vector<Board> roots;
+        roots.reserve(boards.size());
+        for (const BoardWrapper* bw : boards) {
+            if (bw == nullptr) throw std::invalid_argument("boards must not contain None");
+            roots.push_back(bw->board_);
         }
-        return py::make_tuple(uci_list, visits, res.rootValue, res.rootVisits);
-    }, py::arg("board"), py::arg("iterations"), py::arg("seed"),
-       py::arg("prior") = py::none(), py::arg("value") = py::none(),
-       py::arg("batch_eval") = py::none(), py::arg("batch_prior") = py::none(), py::arg("batch_value") = py::none(), py::arg("batch_size") = 32,
-       py::arg("dirichlet_alpha") = 0.0, py::arg("dirichlet_epsilon") = 0.25, py::arg("pfu_scale") = 0.0,
-       "Run MCTS. Use batch_eval(fen_list, uci_list_per_fen) for PVNN (single inference); "
-       "or batch_prior/batch_value for separate calls. "
-       "dirichlet_alpha>0 adds Dirichlet noise at root (e.g. 0.3); dirichlet_epsilon mixes with prior (e.g. 0.25). "
-       "pfu_scale>0 enables PFU (unvisited node initial value = parent_value - pfu_scale/sqrt(parent_N), clipped). "
-       "Returns (uci_list, visits, root_value, root_visits).");
+        py::gil_scoped_release release;
+        return BuildOpeningBook(path, roots, iterations, opts, seedList, threads);
+    }, py::arg("path"), py::arg("boards"), py::arg("iterations"), py::arg("seeds") = py::none(), py::arg("threads") = 0,
+       buildOpeningBookDoc.c_str());
+
+    py::class_<SelfPlayPool>(m, "SelfPlayPool")
+        .def(py::init([](int num_games, int iterations, py::object batch_eval, int target_batch_size,
+                         int workers_per_tree, int max_plies, unsigned int seed, py::object fen,
+                         double c_puct, double dirichlet_alpha, double dirichlet_epsilon, py::object cache,
+                         double temperature, int temperature_plies, int dirichlet_plies, py::object output,
+                         py::object batch_arrays, bool gumbel, int gumbel_top_k) {
+            const bool use_batch_arrays = !batch_arrays.is_none() && py::hasattr(batch_arrays, "__call__");
+            if (!use_batch_arrays && (batch_eval.is_none() || !py::hasattr(batch_eval, "__call__")))
+                throw std::invalid_argument("batch_eval or batch_arrays must be callable");
+            SelfPlayConfig config;
+            config.num_games = num_games;
+            config.iterations = iterations;
+            config.target_batch_size = target_batch_size;
+            config.workers_per_tree = workers_per_tree;
+            config.max_plies = max_plies;
+            if (!fen.is_none()) config.start_fen = fen.cast<std::string>();
+            if (use_batch_arrays)
+                config.options.batch_array_fn = make_batch_array_fn(batch_arrays);
+            else
+                config.options.batch_eval_fn = make_batch_eval_fn(batch_eval);
+            config.options.c_puct = c_puct;
+            config.options.dirichlet_alpha = dirichlet_alpha;
+            config.options.dirichlet_epsilon = dirichlet_epsilon;
+            config.options.gumbel = gumbel;
+            config.options.gumbel_top_k = gumbel_top_k;
+            if (!cache.is_none()) config.options.eval_cache = cache.cast<EvalCache*>();
+            config.temperature = temperature;
+            config.temperature_plies = temperature_plies;
+            config.dirichlet_plies = dirichlet_plies;
+            if (!output.is_none()) config.output_path = output.cast<std::string>();
+            return std::unique_ptr<SelfPlayPool>(new SelfPlayPool(config, seed));
+        }), py::arg("num_games"), py::arg("iterations"), py::arg("batch_eval"),
+            py::arg("target_batch_size") = 256, py::arg("workers_per_tree") = 8, py::arg("max_plies") = 400,
+            py::arg("seed") = 0, py::arg("fen") = py::none(), py::arg("c_puct") = 1.4142135623730950488,
+            py::arg("dirichlet_alpha") = 0.0, py::arg("dirichlet_epsilon") = 0.25, py::arg("cache") = py::none(),
+            py::arg("temperature") = 0.0, py::arg("temperature_plies") = 30, py::arg("dirichlet_plies") = -1,
+            py::arg("output") = py::none(), py::arg("batch_arrays") = py::none(),
+            py::arg("gumbel") = false, py::arg("gumbel_top_k") = 16,
+            py::keep_alive<1, 13>(),
+            "Play num_games self-play games concurrently; every batch_eval(fen_list, uci_list_per_fen) call "
+            "is filled with leaves from all game trees (up to target_batch_size). "
+            "Moves are sampled with visits^(1/temperature) for the first temperature_plies plies; root Dirichlet noise "
+            "is applied for the first dirichlet_plies plies (-1 = always). If output is a path, finished games are "
+            "streamed there as binary training records by a background writer thread. "
+            "batch_arrays (as in run_mcts) replaces batch_eval with zero-copy numpy buffers; pass batch_eval=None then. "
+            "gumbel=True searches each root with Gumbel sequential halving (as in run_mcts): the recorded policy is the "
+            "improved policy instead of the visit counts and, after the temperature plies, the surviving move is played.")
+        .def("step", [](SelfPlayPool& pool) {
+            py::gil_scoped_release release;
+            return pool.Step();
+        }, "Advance all searches by one evaluator call; returns True while games remain.")
+        .def("run", [](SelfPlayPool& pool) {
+            py::gil_scoped_release release;
+            pool.Run();
+        }, "Step until every game has finished, then flush and close the output file.")
+        .def("close", [](SelfPlayPool& pool) {
+            py::gil_scoped_release release;
+            pool.Close();
+        }, "Flush pending training records and close the output file.")
+        .def("games", [](const SelfPlayPool& pool) {
+            py::list out;
+            for (const SelfPlayGame& g : pool.Games()) {
+                std::vector<std::string> uci;
+                uci.reserve(g.moves.size());
+                for (const Move& mv : g.moves) uci.push_back(move_to_uci(mv));
+                py::dict d;
+                d["start_fen"] = g.startFen;
+                d["moves"] = uci;
+                d["result"] = static_cast<int>(g.result);
+                out.append(d);
+            }
+            return out;
+        }, "List of {start_fen, moves (UCI list), result (1/-1/0, 2=ongoing)} per game.")
+        .def_property_readonly("active_games", &SelfPlayPool::ActiveGames)
+        .def_property_readonly("eval_calls", &SelfPlayPool::EvalCalls)
+        .def_property_readonly("evaluated_leaves", &SelfPlayPool::EvaluatedLeaves)
+        .def_property_readonly("records_written", &SelfPlayPool::RecordsWritten);
+
+    m.attr("INPUT_PLANES") = INPUT_PLANES;
+    m.attr("POLICY_SIZE") = POLICY_SIZE;
+
+    using FloatArray = py::array_t<float, py::array::c_style>;
+    // 出力配列の形状を確かめて書き込み先ポインタを返す
+    auto checked = [](FloatArray& a, std::size_t n, std::size_t width, const char* name) {
+        if (a.size() != static_cast<py::ssize_t>(n * width))
+            throw std::invalid_argument(std::string(name) + " must have " + std::to_string(n) + " x " +
+                                        std::to_string(width) + " float32 elements");
+        return a.mutable_data();
+    };
+
+    py::class_<TrainingDataReader>(m, "TrainingDataReader")
+        .def(py::init([](py::object paths, int threads, unsigned int seed) {
+            std::vector<std::string> list;
+            if (py::isinstance<py::str>(paths)) list.push_back(paths.cast<std::string>());
+            else list = paths.cast<std::vector<std::string>>();
+            return std::unique_ptr<TrainingDataReader>(new TrainingDataReader(list, threads, seed));
+        }), py::arg("paths"), py::arg("threads") = 0, py::arg("seed") = 0,
+            "Memory-map training data files written by SelfPlayPool(output=...) and decode minibatches in a thread pool.")
+        .def("__len__", &TrainingDataReader::Size)
+        .def_property_readonly("epoch", &TrainingDataReader::Epoch)
+        .def("next_batch", [checked](TrainingDataReader& r, FloatArray planes, FloatArray policy, FloatArray values,
+                                     py::object root_values) {
+            const std::size_t n = static_cast<std::size_t>(values.size());
+            float* pl = checked(planes, n, INPUT_SIZE, "planes");
+            float* po = checked(policy, n, POLICY_SIZE, "policy");
+            float* v = values.mutable_data();
+            float* rv = nullptr;
+            FloatArray rootArr;
+            if (!root_values.is_none()) {
+                rootArr = root_values.cast<FloatArray>();
+                rv = checked(rootArr, n, 1, "root_values");
+            }
+            py::gil_scoped_release release;
+            r.NextBatch(n, pl, po, v, rv);
+        }, py::arg("planes"), py::arg("policy"), py::arg("values"), py::arg("root_values") = py::none(),
+            "Fill preallocated float32 arrays planes (B, INPUT_PLANES, 8, 8), policy (B, POLICY_SIZE), values (B,) "
+            "with the next B shuffled records. Reshuffles at the end of each epoch.")
+        .def("fill", [checked](TrainingDataReader& r, py::array_t<long long, py::array::c_style | py::array::forcecast> indices,
+                               FloatArray planes, FloatArray policy, FloatArray values, py::object root_values) {
+            const std::size_t n = static_cast<std::size_t>(indices.size());
+            std::vector<std::size_t> idx(indices.data(), indices.data() + n);
+            float* pl = checked(planes, n, INPUT_SIZE, "planes");
+            float* po = checked(policy, n, POLICY_SIZE, "policy");
+            float* v = checked(values, n, 1, "values");
+            float* rv = nullptr;
+            FloatArray rootArr;
+            if (!root_values.is_none()) {
+                rootArr = root_values.cast<FloatArray>();
+                rv = checked(rootArr, n, 1, "root_values");
+            }
+            py::gil_scoped_release release;
+            r.Fill(idx.data(), n, pl, po, v, rv);
+        }, py::arg("indices"), py::arg("planes"), py::arg("policy"), py::arg("values"), py::arg("root_values") = py::none(),
+            "Decode the records at the given indices into preallocated float32 arrays.")
+        .def("fen", [](const TrainingDataReader& r, std::size_t i) {
+            return PackedPositionToFen(r.Record(i).position);
+        }, py::arg("index"));
+
+    py::class_<BoardBatch>(m, "BoardBatch")
+        .def(py::init([](int size, py::object fen, int threads) {
+            const std::string start = fen.is_none() ? std::string() : fen.cast<std::string>();
+            return std::unique_ptr<BoardBatch>(new BoardBatch(size, start, threads));
+        }), py::arg("size"), py::arg("fen") = py::none(), py::arg("threads") = 1,
+            "Vectorized environment holding size games in C++. Actions are policy indices (see policy_indices); "
+            "threads>1 (or <=0 for every hardware thread) spreads each batch operation over a thread pool.")
+        .def("__len__", &BoardBatch::Size)
+        .def("reset", [](BoardBatch& b, py::object indices) {
+            if (indices.is_none()) {
+                py::gil_scoped_release release;
+                b.Reset();
+                return;
+            }
+            const std::vector<std::size_t> idx = indices.cast<std::vector<std::size_t>>();
+            b.Reset(idx.data(), idx.size());
+        }, py::arg("indices") = py::none(), "Reset all games (or only the given indices) to the start position.")
+        .def("step", [](BoardBatch& b, py::array_t<int32_t, py::array::c_style | py::array::forcecast> actions) {
+            if (actions.size() != static_cast<py::ssize_t>(b.Size()))
+                throw std::invalid_argument("actions must have one entry per game");
+            py::array_t<int8_t> results(static_cast<py::ssize_t>(b.Size()));
+            const int32_t* a = actions.data();
+            int8_t* r = results.mutable_data();
+            {
+                py::gil_scoped_release release;
+                b.Step(a, r);
+            }
+            return results;
+        }, py::arg("actions"),
+            "Play one policy-index action per game (ignored for finished games) and return the int8 results "
+            "(1 white win, -1 black win, 0 draw, 2 ongoing). Illegal actions raise before any game is changed.")
+        .def("legal_mask", [](const BoardBatch& b) {
+            py::array_t<bool> mask(std::vector<py::ssize_t>{static_cast<py::ssize_t>(b.Size()), POLICY_SIZE});
+            uint8_t* out = reinterpret_cast<uint8_t*>(mask.mutable_data());
+            py::gil_scoped_release release;
+            b.LegalMask(out);
+            return mask;
+        }, "Bool array (size, POLICY_SIZE) marking the legal moves of every game (all False once finished).")
+        .def("result", [](const BoardBatch& b) {
+            py::array_t<int8_t> results(static_cast<py::ssize_t>(b.Size()));
+            b.Results(results.mutable_data());
+            return results;
+        }, "int8 array of results: 1 white win, -1 black win, 0 draw (mate, stalemate, 50 moves, threefold), 2 ongoing.")
+        .def("encode", [](const BoardBatch& b) {
+            py::array_t<float> planes(std::vector<py::ssize_t>{static_cast<py::ssize_t>(b.Size()), INPUT_PLANES, 8, 8});
+            float* out = planes.mutable_data();
+            py::gil_scoped_release release;
+            b.Encode(out);
+            return planes;
+        }, "float32 array (size, INPUT_PLANES, 8, 8) of network input planes.")
+        .def("white_to_move", [](const BoardBatch& b) {
+            py::array_t<bool> out(static_cast<py::ssize_t>(b.Size()));
+            bool* w = out.mutable_data();
+            for (std::size_t i = 0; i < b.Size(); i++) w[i] = b.At(i).GetWhiteToMove();
+            return out;
+        }, "Bool array of side to move per game.")
+        .def("fen", [](const BoardBatch& b, std::size_t i) {
+            if (i >= b.Size()) throw py::index_error("game index out of range");
+            return b.At(i).GetFen();
+        }, py::arg("index"));
+
+    py::class_<EvalCache>(m, "EvalCache")
+        .def(py::init<std::size_t, std::size_t>(), py::arg("capacity") = static_cast<std::size_t>(1u << 18), py::arg("shards") = 64,
+             "Fixed-size, sharded cache of evaluator results (priors, value) keyed by Zobrist hash.")
+        .def("clear", &EvalCache::Clear)
+        .def("reset_stats", &EvalCache::ResetStats)
+        .def("stats", [](const EvalCache& c) {
+            EvalCache::Stats s = c.GetStats();
+            py::dict d;
+            d["lookups"] = s.lookups;
+            d["hits"] = s.hits;
+            d["inserts"] = s.inserts;
+            d["evictions"] = s.evictions;
+            d["capacity"] = s.capacity;
+            d["size"] = s.size;
+            d["hit_rate"] = s.lookups > 0 ? static_cast<double>(s.hits) / static_cast<double>(s.lookups) : 0.0;
+            return d;
+        }, "Return lookup/hit/insert/eviction counters and hit_rate.");
+
+    py::class_<Tracer>(m, "Tracer")
+        .def(py::init<std::size_t>(), py::arg("capacity") = static_cast<std::size_t>(1u << 20),
+             "Records timestamped spans of the batch search (advance, gather, fen_encode, evaluate, callback, "
+             "gil_wait, to_python, python_call, from_python, expand, backup, wait_eval) per thread into a fixed-size "
+             "buffer. Pass it as run_mcts(..., tracer=t) and write the timeline with write(path).")
+        .def("write", &Tracer::WriteJson, py::arg("path"),
+             "Write Chrome trace_event JSON (open in chrome://tracing or Perfetto). Call after the search has finished.")
+        .def("clear", &Tracer::Clear)
+        .def("__len__", &Tracer::Size)
+        .def_property_readonly("dropped", &Tracer::Dropped, "Spans discarded because the buffer was full.");
+
+    py::class_<OpeningBook>(m, "OpeningBook")
+        .def(py::init<const std::string&>(), py::arg("path"),
+             "Memory-map an opening book written by build_opening_book. Pass it as run_mcts(..., book=b).")
+        .def("__len__", &OpeningBook::Size)
+        .def("__contains__", [](const OpeningBook& b, const BoardWrapper& bw) {
+            return b.Contains(bw.board_.GetZobristHash());
+        }, py::arg("board"))
+        .def("lookup", [](const OpeningBook& b, const BoardWrapper& bw, bool as_arrays) -> py::object {
+            MCTSResult res;
+            if (!b.Lookup(bw.board_, res)) return py::none();
+            return mcts_result_to_py(res, bw.board_.GetWhiteToMove(), true, as_arrays);
+        }, py::arg("board"), py::arg("as_arrays") = false,
+            "Stored result for the board in the run_mcts(return_info=True) format, or None if the position is not in the book.");
+
+    py::class_<Bitbases>(m, "Bitbases")
+        .def(py::init<>(),
+             "Win/draw/loss tables for endings with up to 4 pieces including kings (e.g. 'KPK', 'KRK', 'KQKR', 'KBNK'), "
+             "built by retrograde analysis. The 50-move rule and repetitions are ignored. Pass as run_mcts(..., bitbases=b).")
+        .def("generate", [](Bitbases& b, const std::string& material) {
+            py::gil_scoped_release release;
+            b.Generate(material);
+        }, py::arg("material"), "Build the table in memory, together with the tables reached by captures and promotions.")
+        .def("load_or_generate", [](Bitbases& b, const std::string& material, const std::string& directory) {
+            py::gil_scoped_release release;
+            b.LoadOrGenerate(material, directory);
+        }, py::arg("material"), py::arg("directory"),
+            "Memory-map directory/<material>.bb (and the tables it depends on); build and write the missing ones.")
+        .def("load", &Bitbases::Load, py::arg("path"))
+        .def("save", &Bitbases::Save, py::arg("material"), py::arg("path"))
+        .def("probe", [](const Bitbases& b, const BoardWrapper& bw) -> py::object {
+            const GameResult r = b.Probe(bw.board_);
+            if (r == GameResult::Ongoing) return py::none();
+            return py::int_(r == GameResult::WhiteWin ? 1 : r == GameResult::BlackWin ? -1 : 0);
+        }, py::arg("board"), "1 = White wins, -1 = Black wins, 0 = draw, None if no table covers the position.")
+        .def_property_readonly("materials", &Bitbases::Materials);
 
     py::class_<BoardWrapper>(m, "Board")
         .def(py::init([](py::object fen) {
@@ -190,9 +785,17 @@ PYBIND11_MODULE(chess_engine, m) {
         .def("set_fen", &BoardWrapper::set_fen, py::arg("fen"))
         .def("legal_moves", &BoardWrapper::legal_moves)
         .def("push", &BoardWrapper::push, py::arg("uci"))
+        .def("legal_move_handles", &BoardWrapper::legal_move_handles,
+             "Legal moves as a uint16 numpy array of move handles (from | to<<6 | promotion<<12), in legal_moves() order.")
+        .def("push_move", &BoardWrapper::push_move, py::arg("handle"), "Play a legal move given as a move handle.")
         .def("pop", &BoardWrapper::pop)
         .def("result", &BoardWrapper::result)
         .def_property_readonly("white_to_move", &BoardWrapper::white_to_move)
         .def("fen", &BoardWrapper::fen)
+        .def("see", &BoardWrapper::see, py::arg("uci"),
+             "Static exchange evaluation of a legal move (centipawns, side to move's view), including x-ray attackers. "
+             "Negative for a quiet move that hangs the moved piece.")
+        .def("static_eval", [](const BoardWrapper& bw) { return bw.board_.GetStaticEval(); },
+             "Material + piece-square static evaluation tapered by game phase (centipawns, White's view).")
         .def("get_zobrist_hash", &BoardWrapper::get_zobrist_hash, "Return the Zobrist hash of the current position (64-bit unsigned).");
 }
@@ -0,0 +1,215 @@
+#include "selfplay.hpp"
+#include "batch_search.hpp"
+#include "mcts_detail.hpp"
+#include "movegen.hpp"
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
+
+using namespace mcts_detail;
+
+namespace {
+    /// 反復数を使い切るか、ルートの結果が確定したら探索終了
+    bool searchDone(const BatchSearch& search, int iterations) {
+        return search.Completed() >= iterations || search.Solved();
+    }
+}
+
+struct SelfPlayPool::Slot {
+    std::size_t game;
+    Board board;
+    std::unique_ptr<BatchSearch> search;
+    std::unordered_map<U64, int> hashCount;  // 千日手検出用
+    bool finished = false;
+};
+
+SelfPlayPool::SelfPlayPool(const SelfPlayConfig& config, unsigned int seed)
+    : config_(config), gen_(seed) {
+    MoveGen::Init();
+    config_.num_games = std::max(1, config_.num_games);
+    config_.iterations = std::max(1, config_.iterations);
+    config_.target_batch_size = std::max(1, config_.target_batch_size);
+    config_.workers_per_tree = std::max(1, std::min(config_.workers_per_tree, 1024));
+    noNoiseOptions_ = config_.options;
+    noNoiseOptions_.dirichlet_alpha = 0.0;
+    if (!config_.output_path.empty()) writer_.reset(new TrainingDataWriter(config_.output_path));
+    games_.resize(static_cast<std::size_t>(config_.num_games));
+    for (std::size_t i = 0; i < games_.size(); i++) {
+        std::unique_ptr<Slot> slot(new Slot());
+        slot->game = i;
+        if (!config_.start_fen.empty()) slot->board.SetFromFen(config_.start_fen);
+        slot->hashCount[slot->board.GetZobristHash()] = 1;
+        games_[i].startFen = slot->board.GetFen();
+        const GameResult r = MoveGen::GetGameResult(slot->board);
+        slots_.push_back(std::move(slot));
+        if (r != GameResult::Ongoing)
+            finishGame(*slots_.back(), r);
+        else
+            startSearch(*slots_.back());
+    }
+}
+
+// 閉じていない出力は writer_ のデストラクタが書き切る（失敗は例外にせず標準エラーに出す）
+SelfPlayPool::~SelfPlayPool() = default;
+
+void SelfPlayPool::Close() {
+    if (writer_) writer_->Close();
+}
+
+int SelfPlayPool::ActiveGames() const {
+    int n = 0;
+    for (const auto& s : slots_)
+        if (!s->finished) n++;
+    return n;
+}
+
+void SelfPlayPool::startSearch(Slot& slot) {
+    const int ply = static_cast<int>(games_[slot.game].moves.size());
+    const bool noise = config_.dirichlet_plies < 0 || ply < config_.dirichlet_plies;
+    slot.search.reset(new BatchSearch(slot.board, config_.workers_per_tree, gen_, noise ? config_.options : noNoiseOptions_));
+    slot.search->SetBudget(config_.iterations);
+}
+
+Move SelfPlayPool::chooseMove(const MCTSResult& res, int ply, bool whiteToMove) {
+    const bool provenWin = std::find(res.provenMoves.begin(), res.provenMoves.end(), winFor(whiteToMove)) != res.provenMoves.end();
+    if (!provenWin && config_.temperature > 0.0 && ply < config_.temperature_plies) {
+        // 確定負けの手は証明前の訪問数が残っていても引かない（全て確定負けなら SelectBestMoveIndex に任せる）
+        std::vector<bool> lost(res.visits.size(), false);
+        for (std::size_t i = 0; i < res.visits.size() && i < res.provenMoves.size(); i++)
+            lost[i] = res.provenMoves[i] == winFor(!whiteToMove);
+        std::vector<double> weights(res.visits.size(), 0.0);
+        double maxN = 0.0;
+        for (std::size_t i = 0; i < res.visits.size(); i++)
+            if (!lost[i]) maxN = std::max(maxN, static_cast<double>(res.visits[i].second));
+        double total = 0.0;
+        for (std::size_t i = 0; i < res.visits.size(); i++) {
+            if (lost[i]) continue;
+            // 最大訪問数で割ってから累乗し、低温でのオーバーフローを避ける
+            weights[i] = maxN > 0.0 ? std::pow(res.visits[i].second / maxN, 1.0 / config_.temperature) : 1.0;
+            total += weights[i];
+        }
+        if (total > 0.0) {
+            std::discrete_distribution<std::size_t> dist(weights.begin(), weights.end());
+            return res.visits[dist(gen_)].first;
+        }
+    }
+    return res.visits[static_cast<std::size_t>(SelectBestMoveIndex(res, whiteToMove))].first;
+}
+
+void SelfPlayPool::playMove(Slot& slot) {
+    MCTSResult res = slot.search->Result();
+    slot.search.reset();
+    SelfPlayGame& game = games_[slot.game];
+    if (res.visits.empty()) {
+        finishGame(slot, MoveGen::GetGameResult(slot.board));
+        return;
+    }
+
+    TrainingRecord rec;
+    rec.position = PackPosition(slot.board);
+    rec.rootValue = static_cast<float>(res.rootValue);
+    rec.policy.reserve(res.visits.size());
+    for (std::size_t i = 0; i < res.visits.size(); i++) {
+        // Gumbel のルート探索では訪問数の代わりに改善方策を 65535 倍して記録する（読み出し時に合計 1 へ正規化される）
+        const int weight = res.improvedPolicy.empty()
+                               ? std::min(res.visits[i].second, 0xFFFF)
+                               : static_cast<int>(std::lround(res.improvedPolicy[i] * 0xFFFF));
+        rec.policy.push_back({static_cast<uint16_t>(MoveToPolicyIndex(res.visits[i].first)), static_cast<uint16_t>(weight)});
+    }
+    game.records.push_back(std::move(rec));
+
+    const Move move = chooseMove(res, static_cast<int>(game.moves.size()), slot.board.GetWhiteToMove());
+    slot.board.MakeMove(move);
+    game.moves.push_back(move);
+
+    GameResult r = MoveGen::GetGameResult(slot.board);
+    if (r == GameResult::Ongoing && ++slot.hashCount[slot.board.GetZobristHash()] >= 3) r = GameResult::Draw;
+    if (r == GameResult::Ongoing && static_cast<int>(game.moves.size()) >= config_.max_plies) r = GameResult::Draw;
+    if (r != GameResult::Ongoing) {
+        finishGame(slot, r);
+        return;
+    }
+    startSearch(slot);
+}
+
+void SelfPlayPool::finishGame(Slot& slot, GameResult result) {
+    SelfPlayGame& game = games_[slot.game];
+    game.result = result;
+    slot.finished = true;
+    for (TrainingRecord& rec : game.records) {
+        const bool whiteToMove = (rec.position.flags & 1u) != 0;
+        if (result == GameResult::WhiteWin) rec.result = whiteToMove ? 1 : -1;
+        else if (result == GameResult::BlackWin) rec.result = whiteToMove ? -1 : 1;
+        else rec.result = 0;
+    }
+    if (writer_) {
+        writer_->Write(game.records);
+        game.records.clear();
+        game.records.shrink_to_fit();
+    }
+}
+
+bool SelfPlayPool::Step() {
+    const int iterations = config_.iterations;
+    const std::size_t target = static_cast<std::size_t>(config_.target_batch_size);
+
+    // 全木の RUN ワーカーをリーフまで進め、評価待ちが target に達するか進めるワーカーがなくなるまで繰り返す
+    while (true) {
+        std::size_t needEval = 0;
+        bool anyRunning = false;
+        for (auto& s : slots_) {
+            if (s->finished || searchDone(*s->search, iterations)) continue;
+            s->search->Advance();
+            needEval += s->search->CountState(NEED_EVAL);
+            anyRunning = anyRunning || s->search->CountState(RUN) > 0;
+        }
+        if (needEval >= target || !anyRunning) break;
+    }
+
+    // 開始位置をずらしながら各木からリーフを集める（1 木あたり残りシミュレーション数まで）
+    std::vector<EvalBatch*> batches;
+    std::vector<Slot*> batchSlots;
+    std::size_t gathered = 0;
+    for (std::size_t k = 0; k < slots_.size() && gathered < target; k++) {
+        Slot& s = *slots_[(nextSlot_ + k) % slots_.size()];
+        if (s.finished) continue;
+        const int quota = iterations - s.search->Completed();
+        if (quota <= 0 || s.search->Solved()) continue;
+        // バッチは手ごとに使い回す（先頭のバッチが持つ batch_array_fn の連結バッファも確保し直さない）
+        if (batches.size() == batchPool_.size()) batchPool_.emplace_back(new EvalBatch());
+        EvalBatch* batch = batchPool_[batches.size()].get();
+        batch->Clear();
+        const std::size_t n = s.search->Gather(*batch, std::min(target - gathered, static_cast<std::size_t>(quota)));
+        if (n == 0) continue;
+        gathered += n;
+        batches.push_back(batch);
+        batchSlots.push_back(&s);
+    }
+    nextSlot_ = slots_.empty() ? 0 : (nextSlot_ + 1) % slots_.size();
+
+    if (!batches.empty()) {
+        evaluateBatches(batches, config_.options);
+        for (const EvalBatch* b : batches) {
+            if (!b->fens.empty()) {
+                evalCalls_++;
+                break;
+            }
+        }
+        evaluatedLeaves_ += static_cast<long>(gathered);
+        for (std::size_t i = 0; i < batches.size(); i++) {
+            BatchSearch& search = *batchSlots[i]->search;
+            search.Integrate(*batches[i], iterations - search.Completed());
+        }
+    }
+
+    for (auto& s : slots_) {
+        if (!s->finished && searchDone(*s->search, iterations)) playMove(*s);
+    }
+    return ActiveGames() > 0;
+}
+
+void SelfPlayPool::Run() {
+    while (Step()) {
+    }
+    Close();
+}
@@ -0,0 +1,70 @@
+#include "thread_pool.hpp"
+#include <algorithm>
+#include <exception>
+
+ThreadPool::ThreadPool(int numThreads) {
+    if (numThreads <= 0) numThreads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    for (int i = 0; i < numThreads; i++)
+        threads_.emplace_back(&ThreadPool::run, this);
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    cv_.notify_all();
+    for (std::thread& t : threads_) t.join();
+}
+
+void ThreadPool::Submit(std::function<void()> task) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        tasks_.push_back(std::move(task));
+    }
+    cv_.notify_one();
+}
+
+void ThreadPool::ParallelFor(std::size_t n, const std::function<void(std::size_t, std::size_t)>& fn) {
+    if (n == 0) return;
+    const std::size_t chunks = std::min<std::size_t>(n, threads_.size());
+    if (chunks <= 1) {
+        fn(0, n);
+        return;
+    }
+    std::mutex doneMutex;
+    std::condition_variable doneCv;
+    std::size_t pending = chunks;
+    std::exception_ptr error;
+    for (std::size_t c = 0; c < chunks; c++) {
+        const std::size_t begin = n * c / chunks;
+        const std::size_t end = n * (c + 1) / chunks;
+        Submit([&, begin, end]() {
+            try {
+                fn(begin, end);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(doneMutex);
+                if (!error) error = std::current_exception();
+            }
+            std::lock_guard<std::mutex> lock(doneMutex);
+            if (--pending == 0) doneCv.notify_one();
+        });
+    }
+    std::unique_lock<std::mutex> lock(doneMutex);
+    doneCv.wait(lock, [&]() { return pending == 0; });
+    if (error) std::rethrow_exception(error);
+}
+
+void ThreadPool::run() {
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            cv_.wait(lock, [this]() { return stopping_ || !tasks_.empty(); });
+            if (stopping_ && tasks_.empty()) return;
+            task = std::move(tasks_.front());
+            tasks_.pop_front();
+        }
+        task();
+    }
+}
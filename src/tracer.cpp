@@ -0,0 +1,97 @@
+#include "tracer.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+    /// 生きているスレッドの間で一意な番号。終了したスレッドの番号は次に記録を始めたスレッドに使い回す
+    /// （パイプラインの評価は std::async でバッチごとに別スレッドになるので、タイムラインの行が増え続けないように）
+    class ThreadSlot {
+    public:
+        ThreadSlot() {
+            std::lock_guard<std::mutex> lock(mutex());
+            std::vector<uint32_t>& freeIds = freeList();
+            if (freeIds.empty()) {
+                id = nextId()++;
+            } else {
+                auto it = std::min_element(freeIds.begin(), freeIds.end());
+                id = *it;
+                freeIds.erase(it);
+            }
+        }
+        ~ThreadSlot() {
+            std::lock_guard<std::mutex> lock(mutex());
+            freeList().push_back(id);
+        }
+
+        uint32_t id;
+
+    private:
+        static std::mutex& mutex() {
+            static std::mutex m;
+            return m;
+        }
+        static std::vector<uint32_t>& freeList() {
+            static std::vector<uint32_t> ids;
+            return ids;
+        }
+        static uint32_t& nextId() {
+            static uint32_t n = 1;
+            return n;
+        }
+    };
+
+    uint32_t currentThreadId() {
+        thread_local ThreadSlot slot;
+        return slot.id;
+    }
+}
+
+Tracer::Tracer(std::size_t capacity)
+    : events_(new Event[std::max<std::size_t>(1, capacity)]),
+      capacity_(std::max<std::size_t>(1, capacity)),
+      next_(0),
+      start_(std::chrono::steady_clock::now()) {}
+
+void Tracer::Record(const char* name, double startUs, double endUs) {
+    const std::size_t i = next_.fetch_add(1, std::memory_order_relaxed);
+    if (i >= capacity_) return;
+    events_[i] = Event{name, currentThreadId(), startUs, std::max(0.0, endUs - startUs)};
+}
+
+double Tracer::Now() const {
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start_).count();
+}
+
+std::size_t Tracer::Size() const {
+    return std::min(next_.load(std::memory_order_relaxed), capacity_);
+}
+
+std::size_t Tracer::Dropped() const {
+    const std::size_t n = next_.load(std::memory_order_relaxed);
+    return n > capacity_ ? n - capacity_ : 0;
+}
+
+void Tracer::Clear() {
+    next_.store(0, std::memory_order_relaxed);
+    start_ = std::chrono::steady_clock::now();
+}
+
+void Tracer::WriteJson(const std::string& path) const {
+    std::ofstream out(path);
+    if (!out) throw std::runtime_error("cannot open trace file: " + path);
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    const std::size_t n = Size();
+    char buf[256];
+    for (std::size_t i = 0; i < n; i++) {
+        const Event& e = events_[i];
+        std::snprintf(buf, sizeof(buf), "{\"name\":\"%s\",\"cat\":\"mcts\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+                      e.name, static_cast<unsigned>(e.tid), e.startUs, e.durUs);
+        out << buf << (i + 1 < n ? ",\n" : "\n");
+    }
+    out << "]}\n";
+    if (!out) throw std::runtime_error("failed to write trace file: " + path);
+}
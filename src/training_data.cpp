@@ -0,0 +1,335 @@
+#include "training_data.hpp"
+#include "encoding.hpp"
+#include "move.hpp"
+#include "thread_pool.hpp"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <numeric>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+    void putU16(std::string& out, uint16_t v) {
+        out.push_back(static_cast<char>(v & 0xFF));
+        out.push_back(static_cast<char>(v >> 8));
+    }
+
+    uint16_t getU16(const uint8_t* p) {
+        return static_cast<uint16_t>(p[0] | (p[1] << 8));
+    }
+
+    void putU64(std::string& out, U64 v) {
+        for (int i = 0; i < 8; i++) out.push_back(static_cast<char>((v >> (8 * i)) & 0xFF));
+    }
+
+    U64 getU64(const uint8_t* p) {
+        U64 v = 0;
+        for (int i = 0; i < 8; i++) v |= static_cast<U64>(p[i]) << (8 * i);
+        return v;
+    }
+
+    void putF32(std::string& out, float f) {
+        uint32_t v;
+        std::memcpy(&v, &f, sizeof(v));
+        for (int i = 0; i < 4; i++) out.push_back(static_cast<char>((v >> (8 * i)) & 0xFF));
+    }
+
+    float getF32(const uint8_t* p) {
+        uint32_t v = 0;
+        for (int i = 0; i < 4; i++) v |= static_cast<uint32_t>(p[i]) << (8 * i);
+        float f;
+        std::memcpy(&f, &v, sizeof(f));
+        return f;
+    }
+}
+
+PackedPosition PackPosition(const Board& board) {
+    PackedPosition pos;
+    pos.occupancy = board.GetAllPieces();
+    const U64 white = board.GetWhitePieces();
+    U64 occ = pos.occupancy;
+    int n = 0;
+    while (occ && n < 32) {
+        const int sq = __builtin_ctzll(occ);
+        occ &= occ - 1;
+        uint8_t code = static_cast<uint8_t>(board.GetPieceAt(static_cast<Square>(sq)));
+        if (!(white & (1ULL << sq))) code += 8;
+        pos.pieces[n / 2] |= static_cast<uint8_t>((n % 2 == 0) ? code : (code << 4));
+        n++;
+    }
+    pos.flags = board.GetWhiteToMove() ? 1u : 0u;
+    if (board.CanWhiteKingsideCastle()) pos.flags |= 2u;
+    if (board.CanWhiteQueensideCastle()) pos.flags |= 4u;
+    if (board.CanBlackKingsideCastle()) pos.flags |= 8u;
+    if (board.CanBlackQueensideCastle()) pos.flags |= 16u;
+    pos.epSquare = static_cast<int8_t>(board.GetEnPassantTarget());
+    pos.halfMoveClock = static_cast<uint8_t>(std::min(board.GetHalfMoveClock(), 255));
+    return pos;
+}
+
+std::string PackedPositionToFen(const PackedPosition& pos) {
+    static const char kPieceChars[] = " pnbrqk";
+    char grid[64];
+    std::memset(grid, 0, sizeof(grid));
+    U64 occ = pos.occupancy;
+    int n = 0;
+    while (occ && n < 32) {
+        const int sq = __builtin_ctzll(occ);
+        occ &= occ - 1;
+        const uint8_t code = (n % 2 == 0) ? (pos.pieces[n / 2] & 0x0F) : (pos.pieces[n / 2] >> 4);
+        const int pt = code & 7;
+        if (pt >= PAWN && pt <= KING) {
+            char c = kPieceChars[pt];
+            grid[sq] = (code & 8) ? c : static_cast<char>(c - 'a' + 'A');
+        }
+        n++;
+    }
+    std::ostringstream oss;
+    for (int r = 7; r >= 0; r--) {
+        int empty = 0;
+        for (int f = 0; f < 8; f++) {
+            const char c = grid[r * 8 + f];
+            if (!c) { empty++; continue; }
+            if (empty) { oss << empty; empty = 0; }
+            oss << c;
+        }
+        if (empty) oss << empty;
+        if (r > 0) oss << '/';
+    }
+    oss << ((pos.flags & 1u) ? " w " : " b ");
+    if ((pos.flags & 30u) == 0) oss << '-';
+    else {
+        if (pos.flags & 2u) oss << 'K';
+        if (pos.flags & 4u) oss << 'Q';
+        if (pos.flags & 8u) oss << 'k';
+        if (pos.flags & 16u) oss << 'q';
+    }
+    oss << ' ' << (pos.epSquare >= 0 ? SquareToStr(static_cast<Square>(pos.epSquare)) : "-");
+    oss << ' ' << static_cast<int>(pos.halfMoveClock) << " 1";
+    return oss.str();
+}
+
+void SerializeRecord(const TrainingRecord& rec, std::string& out) {
+    putU64(out, rec.position.occupancy);
+    out.append(reinterpret_cast<const char*>(rec.position.pieces), sizeof(rec.position.pieces));
+    out.push_back(static_cast<char>(rec.position.flags));
+    out.push_back(static_cast<char>(rec.position.epSquare));
+    out.push_back(static_cast<char>(rec.position.halfMoveClock));
+    out.push_back(static_cast<char>(rec.result));
+    putF32(out, rec.rootValue);
+    const std::size_t n = std::min<std::size_t>(rec.policy.size(), 0xFFFF);
+    putU16(out, static_cast<uint16_t>(n));
+    for (std::size_t i = 0; i < n; i++) {
+        putU16(out, rec.policy[i].first);
+        putU16(out, rec.policy[i].second);
+    }
+}
+
+bool ParseRecord(const uint8_t* data, std::size_t size, std::size_t& offset, TrainingRecord& rec) {
+    if (offset + TRAINING_RECORD_FIXED_SIZE > size) return false;
+    const uint8_t* p = data + offset;
+    rec.position.occupancy = getU64(p);
+    std::memcpy(rec.position.pieces, p + 8, sizeof(rec.position.pieces));
+    rec.position.flags = p[24];
+    rec.position.epSquare = static_cast<int8_t>(p[25]);
+    rec.position.halfMoveClock = p[26];
+    rec.result = static_cast<int8_t>(p[27]);
+    rec.rootValue = getF32(p + 28);
+    const std::size_t n = getU16(p + 32);
+    if (offset + TRAINING_RECORD_FIXED_SIZE + 4 * n > size) return false;
+    rec.policy.resize(n);
+    const uint8_t* q = p + TRAINING_RECORD_FIXED_SIZE;
+    for (std::size_t i = 0; i < n; i++)
+        rec.policy[i] = {getU16(q + 4 * i), getU16(q + 4 * i + 2)};
+    offset += TRAINING_RECORD_FIXED_SIZE + 4 * n;
+    return true;
+}
+
+TrainingDataWriter::TrainingDataWriter(const std::string& path) : path_(path) {
+    out_.open(path, std::ios::binary | std::ios::app);
+    if (!out_) throw std::runtime_error("cannot open training data file: " + path);
+    out_.seekp(0, std::ios::end);
+    if (out_.tellp() == 0) {
+        std::string header(TRAINING_MAGIC, 4);
+        for (int i = 0; i < 4; i++) header.push_back(static_cast<char>((TRAINING_VERSION >> (8 * i)) & 0xFF));
+        out_.write(header.data(), static_cast<std::streamsize>(header.size()));
+        if (!out_) throw std::runtime_error("cannot write training data file: " + path);
+    }
+    thread_ = std::thread(&TrainingDataWriter::run, this);
+}
+
+TrainingDataWriter::~TrainingDataWriter() {
+    // デストラクタからは投げられないので、Close で閉じていなければ失敗は標準エラーに出す
+    try {
+        Close();
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+    }
+}
+
+void TrainingDataWriter::Write(const std::vector<TrainingRecord>& records) {
+    if (records.empty()) return;
+    std::string buf;
+    buf.reserve(records.size() * (TRAINING_RECORD_FIXED_SIZE + 4 * 32));
+    for (const TrainingRecord& r : records) SerializeRecord(r, buf);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (closing_) return;
+        if (failed_) throw std::runtime_error("cannot write training data file: " + path_);
+        queue_.emplace_back(std::move(buf), static_cast<long>(records.size()));
+    }
+    cv_.notify_one();
+}
+
+void TrainingDataWriter::Close() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        closing_ = true;
+    }
+    cv_.notify_one();
+    if (thread_.joinable()) thread_.join();
+    if (!out_.is_open()) return;
+    out_.close();
+    if (failed_ || out_.fail())
+        throw std::runtime_error("cannot write training data file: " + path_ + " (" + std::to_string(recordsWritten_) +
+                                 " records written)");
+}
+
+long TrainingDataWriter::RecordsWritten() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return recordsWritten_;
+}
+
+void TrainingDataWriter::run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        cv_.wait(lock, [this]() { return closing_ || !queue_.empty(); });
+        while (!queue_.empty()) {
+            std::pair<std::string, long> item = std::move(queue_.front());
+            queue_.pop_front();
+            if (failed_) continue;
+            lock.unlock();
+            // 1 回の Write ぶんごとにフラッシュし、OS に渡せたレコードだけを書き込み済みとして数える
+            out_.write(item.first.data(), static_cast<std::streamsize>(item.first.size()));
+            out_.flush();
+            const bool ok = static_cast<bool>(out_);
+            lock.lock();
+            if (ok)
+                recordsWritten_ += item.second;
+            else
+                failed_ = true;
+        }
+        if (closing_) break;
+    }
+}
+
+TrainingDataReader::TrainingDataReader(const std::vector<std::string>& paths, int numThreads, unsigned int seed)
+    : pool_(new ThreadPool(numThreads)), gen_(seed) {
+    // 途中のファイルで例外になるとデストラクタは走らないので、それまでの mmap はここで解放してから投げ直す
+    files_.reserve(paths.size());
+    try {
+        for (const std::string& path : paths) {
+            const int fd = ::open(path.c_str(), O_RDONLY);
+            if (fd < 0) throw std::runtime_error("cannot open training data file: " + path);
+            struct stat st;
+            if (::fstat(fd, &st) != 0) {
+                ::close(fd);
+                throw std::runtime_error("cannot stat training data file: " + path);
+            }
+            MappedFile file;
+            file.size = static_cast<std::size_t>(st.st_size);
+            if (file.size > 0) {
+                void* p = ::mmap(nullptr, file.size, PROT_READ, MAP_SHARED, fd, 0);
+                if (p == MAP_FAILED) {
+                    ::close(fd);
+                    throw std::runtime_error("cannot mmap training data file: " + path);
+                }
+                file.data = static_cast<const uint8_t*>(p);
+            }
+            ::close(fd);
+            if (file.size < TRAINING_FILE_HEADER_SIZE || std::memcmp(file.data, TRAINING_MAGIC, 4) != 0 ||
+                (file.data[4] | (file.data[5] << 8) | (file.data[6] << 16) | (static_cast<uint32_t>(file.data[7]) << 24)) != TRAINING_VERSION) {
+                if (file.data) ::munmap(const_cast<uint8_t*>(file.data), file.size);
+                throw std::runtime_error("not a training data file: " + path);
+            }
+            files_.push_back(file);
+
+            // 可変長部分の長さだけを読んでレコード開始位置を並べる
+            std::size_t offset = TRAINING_FILE_HEADER_SIZE;
+            while (offset + TRAINING_RECORD_FIXED_SIZE <= file.size) {
+                const std::size_t n = getU16(file.data + offset + 32);
+                const std::size_t next = offset + TRAINING_RECORD_FIXED_SIZE + 4 * n;
+                if (next > file.size) break;
+                index_.push_back({static_cast<uint32_t>(files_.size() - 1), offset});
+                offset = next;
+            }
+        }
+    } catch (...) {
+        for (const MappedFile& f : files_)
+            if (f.data) ::munmap(const_cast<uint8_t*>(f.data), f.size);
+        throw;
+    }
+    order_.resize(index_.size());
+    std::iota(order_.begin(), order_.end(), std::size_t(0));
+    std::shuffle(order_.begin(), order_.end(), gen_);
+}
+
+TrainingDataReader::~TrainingDataReader() {
+    pool_.reset();
+    for (const MappedFile& f : files_)
+        if (f.data) ::munmap(const_cast<uint8_t*>(f.data), f.size);
+}
+
+TrainingRecord TrainingDataReader::Record(std::size_t i) const {
+    if (i >= index_.size()) throw std::out_of_range("training record index out of range");
+    const MappedFile& f = files_[index_[i].file];
+    std::size_t offset = static_cast<std::size_t>(index_[i].offset);
+    TrainingRecord rec;
+    ParseRecord(f.data, f.size, offset, rec);
+    return rec;
+}
+
+void TrainingDataReader::decode(std::size_t index, float* planes, float* policy, float* value, float* rootValue) const {
+    const TrainingRecord rec = Record(index);
+    EncodePackedPosition(rec.position, planes);
+    std::fill(policy, policy + POLICY_SIZE, 0.0f);
+    double total = 0.0;
+    for (const auto& p : rec.policy) total += p.second;
+    if (total > 0.0) {
+        for (const auto& p : rec.policy)
+            if (p.first < POLICY_SIZE) policy[p.first] += static_cast<float>(p.second / total);
+    }
+    *value = static_cast<float>(rec.result);
+    if (rootValue) *rootValue = rec.rootValue;
+}
+
+void TrainingDataReader::Fill(const std::size_t* indices, std::size_t n, float* planes, float* policy, float* values,
+                              float* rootValues) {
+    for (std::size_t i = 0; i < n; i++)
+        if (indices[i] >= index_.size()) throw std::out_of_range("training record index out of range");
+    pool_->ParallelFor(n, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; i++)
+            decode(indices[i], planes + i * INPUT_SIZE, policy + i * POLICY_SIZE, values + i,
+                   rootValues ? rootValues + i : nullptr);
+    });
+}
+
+void TrainingDataReader::NextBatch(std::size_t n, float* planes, float* policy, float* values, float* rootValues) {
+    if (order_.empty()) throw std::runtime_error("training data is empty");
+    std::vector<std::size_t> indices(n);
+    for (std::size_t i = 0; i < n; i++) {
+        if (cursor_ >= order_.size()) {
+            std::shuffle(order_.begin(), order_.end(), gen_);
+            cursor_ = 0;
+            epoch_++;
+        }
+        indices[i] = order_[cursor_++];
+    }
+    Fill(indices.data(), n, planes, policy, values, rootValues);
+}
@@ -0,0 +1,319 @@
+#include "uci.hpp"
+#include "movegen.hpp"
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cstdlib>
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+namespace {
+    const char* START_FEN = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+
+    bool findUciMove(Board& board, const std::string& uci, Move& out) {
+        std::vector<Move> moves;
+        MoveGen::GenerateLegalMoves(board, moves);
+        for (const Move& m : moves) {
+            if (MoveToUci(m) == uci) {
+                out = m;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /// 終局までの手数が分からない確定勝ち・負け（ビットベース・定跡）の評価値。GUI が詰みの手数として扱わない大きな値
+    const int PROVEN_CENTIPAWNS = 20000;
+    /// 探索中に info を出す間隔（ミリ秒）。探索をこの長さに区切って MCTSTree::Search を呼び直す
+    const double INFO_INTERVAL_MS = 1000.0;
+    /// 制限のない go（ponder / infinite 以外）で探索するノード数
+    const int DEFAULT_GO_NODES = 1 << 16;
+
+    /// go depth N を置き換えるノード数。深さ 1 で 128、1 増えるごとに倍（深さ 16 以上は 400 万程度で頭打ち）
+    int nodesForDepth(int depth) {
+        return 128 << std::max(0, std::min(depth - 1, 15));
+    }
+
+    bool isGoKeyword(const std::string& token) {
+        static const char* const KEYWORDS[] = {"searchmoves", "ponder", "wtime", "btime", "winc", "binc", "movestogo",
+                                               "depth", "nodes", "mate", "movetime", "infinite"};
+        for (const char* k : KEYWORDS)
+            if (token == k) return true;
+        return false;
+    }
+
+    /// ルート手番から見た値 [-1,1] を静的評価と同じ尺度（tanh(cp/400)）でセンチポーンに戻す
+    int valueToCentipawns(double v) {
+        v = std::max(-0.999, std::min(0.999, v));
+        return static_cast<int>(std::lround(400.0 * std::atanh(v)));
+    }
+}
+
+UCIEngine::UCIEngine(std::istream& in, std::ostream& out)
+    : in_(in), out_(out), gen_(std::random_device{}()), stopFlag_(false) {
+    MoveGen::Init();
+    tree_.SetPosition(board_);
+}
+
+UCIEngine::~UCIEngine() {
+    stopSearch();
+}
+
+void UCIEngine::Run() {
+    std::string line;
+    while (std::getline(in_, line)) {
+        if (!Handle(line)) break;
+    }
+    stopSearch();
+}
+
+void UCIEngine::send(const std::string& line) {
+    std::lock_guard<std::mutex> lock(outMutex_);
+    out_ << line << std::endl;
+}
+
+bool UCIEngine::Handle(const std::string& line) {
+    std::istringstream args(line);
+    std::string cmd;
+    if (!(args >> cmd)) return true;
+    if (cmd == "uci") {
+        uci();
+    } else if (cmd == "isready") {
+        send("readyok");
+    } else if (cmd == "ucinewgame") {
+        stopSearch();
+        tree_.Clear();
+    } else if (cmd == "setoption") {
+        setOption(args);
+    } else if (cmd == "position") {
+        stopSearch();
+        position(args);
+    } else if (cmd == "go") {
+        stopSearch();
+        go(args);
+    } else if (cmd == "stop") {
+        stopSearch();
+    } else if (cmd == "ponderhit") {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            ponderhit_ = true;
+        }
+        stopFlag_ = true;
+        cv_.notify_all();
+    } else if (cmd == "quit") {
+        stopSearch();
+        return false;
+    }
+    return true;
+}
+
+void UCIEngine::uci() {
+    send("id name chess-mcts");
+    send("id author chess-mcts developers");
+    send("option name Ponder type check default false");
+    send("option name StaticEval type check default true");
+    send("option name MoveOverhead type spin default 50 min 0 max 5000");
+    send("option name Hash type spin default 256 min 1 max 65536");
+    send("uciok");
+}
+
+void UCIEngine::setOption(std::istringstream& args) {
+    std::string token, name, value;
+    bool inValue = false;
+    while (args >> token) {
+        if (token == "name") continue;
+        if (token == "value") {
+            inValue = true;
+            continue;
+        }
+        std::string& dst = inValue ? value : name;
+        if (!dst.empty()) dst += ' ';
+        dst += token;
+    }
+    if (name == "StaticEval") useStaticEval_ = (value == "true");
+    else if (name == "MoveOverhead") moveOverheadMs_ = std::max(0.0, std::atof(value.c_str()));
+    else if (name == "Hash") hashMb_ = std::max(1, std::atoi(value.c_str()));
+}
+
+void UCIEngine::position(std::istringstream& args) {
+    std::string token;
+    args >> token;
+    Board board;
+    if (token == "fen") {
+        std::string fen;
+        while (args >> token && token != "moves") fen += (fen.empty() ? "" : " ") + token;
+        board.SetFromFen(fen);
+    } else {
+        board.SetFromFen(START_FEN);
+        args >> token;  // "moves"
+    }
+    if (token == "moves") {
+        while (args >> token) {
+            Move m;
+            if (!findUciMove(board, token, m)) {
+                send("info string illegal move " + token);
+                break;
+            }
+            board.MakeMove(m);
+        }
+    }
+    board_ = board;
+}
+
+void UCIEngine::go(std::istringstream& args) {
+    GoParams params;
+    std::string token;
+    bool limited = false;
+    while (args >> token) {
+        if (token == "infinite") params.infinite = true;
+        else if (token == "ponder") params.ponder = true;
+        else if (token == "nodes") { args >> params.nodes; limited = true; }
+        else if (token == "movetime") { args >> params.movetimeMs; limited = true; }
+        else if (token == "wtime") { args >> params.wtimeMs; limited = true; }
+        else if (token == "btime") { args >> params.btimeMs; limited = true; }
+        else if (token == "winc") args >> params.wincMs;
+        else if (token == "binc") args >> params.bincMs;
+        else if (token == "movestogo") args >> params.movestogo;
+        else if (token == "depth") { args >> params.depth; limited = true; }
+        else if (token == "mate") { args >> params.mate; limited = true; }
+        else if (token == "searchmoves") {
+            // 手の制限は未対応。続く手を読み飛ばして全合法手を探索する
+            std::streampos pos = args.tellg();
+            while (args >> token && !isGoKeyword(token)) pos = args.tellg();
+            args.clear();
+            args.seekg(pos);
+            send("info string searchmoves is not supported, searching all moves");
+        } else {
+            send("info string ignoring unsupported go parameter " + token);
+        }
+    }
+    if (params.depth > 0 || params.mate > 0) {
+        // MCTS には探索の深さがないので、深さ（mate N は 2N プライ）に応じたノード数の予算で探索する。
+        // mate は MCTS-solver がルートを確定させた時点でも止まる
+        const int nodes = nodesForDepth(params.mate > 0 ? 2 * params.mate : params.depth);
+        params.nodes = params.nodes > 0 ? std::min(params.nodes, nodes) : nodes;
+        send("info string " + std::string(params.mate > 0 ? "mate" : "depth") + " limit searched as " +
+             std::to_string(nodes) + " nodes");
+    }
+    // 制限のない go は無限探索にせず（GUI が stop を送らないと止まらないため）、既定のノード数で探索する
+    if (!limited && !params.infinite) {
+        params.nodes = DEFAULT_GO_NODES;
+        send("info string no search limit given, searching " + std::to_string(DEFAULT_GO_NODES) + " nodes");
+    }
+
+    const bool reused = tree_.SetPosition(board_);
+    if (reused && tree_.RootVisits() > 0)
+        send("info string reusing tree with " + std::to_string(tree_.RootVisits()) + " visits");
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopRequested_ = false;
+        ponderhit_ = false;
+    }
+    stopFlag_ = false;
+    thread_ = std::thread(&UCIEngine::search, this, params);
+}
+
+void UCIEngine::stopSearch() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopRequested_ = true;
+    }
+    stopFlag_ = true;
+    cv_.notify_all();
+    if (thread_.joinable()) thread_.join();
+}
+
+double UCIEngine::timeBudgetMs(const GoParams& params, bool whiteToMove) const {
+    if (params.movetimeMs > 0.0) return std::max(1.0, params.movetimeMs - moveOverheadMs_);
+    const double remaining = whiteToMove ? params.wtimeMs : params.btimeMs;
+    if (remaining < 0.0) return 0.0;
+    const double inc = whiteToMove ? params.wincMs : params.bincMs;
+    const int movesLeft = params.movestogo > 0 ? params.movestogo : 30;
+    const double budget = remaining / movesLeft + inc * 0.75;
+    return std::max(1.0, std::min(budget, remaining - moveOverheadMs_));
+}
+
+void UCIEngine::search(GoParams params) {
+    const bool whiteToMove = tree_.RootBoard().GetWhiteToMove();
+    MCTSResult res;
+    int simulations = 0;
+    double elapsedMs = 0.0;
+    while (true) {
+        // ponder / infinite 中は時間も反復数も区切らず、stop か ponderhit まで探索する
+        const bool unbounded = params.ponder || params.infinite;
+        MCTSOptions options;
+        options.static_eval = useStaticEval_;
+        options.solver = true;  // 詰みの手数（score mate）を出すため
+        options.stop_flag = &stopFlag_;
+        options.memory_limit_bytes = static_cast<std::size_t>(hashMb_) << 20;
+        const double budgetMs = unbounded ? 0.0 : timeBudgetMs(params, whiteToMove);
+        const int nodeBudget = (!unbounded && params.nodes > 0) ? params.nodes : INT_MAX;
+        // INFO_INTERVAL_MS ごとに区切って探索し、区切りごとに info を出す（infinite / ponder 中も進み具合が GUI に見える）
+        int searched = 0;
+        double spentMs = 0.0;
+        while (true) {
+            options.time_limit_ms = (budgetMs > 0.0) ? std::min(INFO_INTERVAL_MS, budgetMs - spentMs) : INFO_INTERVAL_MS;
+            const int before = tree_.RootVisits();
+            res = tree_.Search(nodeBudget - searched, gen_, options);
+            searched += tree_.RootVisits() - before;
+            simulations += tree_.RootVisits() - before;
+            spentMs += res.elapsedMs;
+            elapsedMs += res.elapsedMs;
+            // 区切りの時間切れ以外（ノード数・確定・stop / ponderhit）か、持ち時間を使い切ったら終わり
+            if (res.stopReason != MCTSStopReason::TimeLimit || (budgetMs > 0.0 && spentMs >= budgetMs)) break;
+            sendInfo(res, simulations, elapsedMs);
+        }
+        if (!unbounded) break;
+
+        // 予算より先に探索が終わっても（確定など）、bestmove は stop / ponderhit まで出さない
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [this]() { return stopRequested_ || ponderhit_; });
+        if (stopRequested_ || !params.ponder) break;
+        ponderhit_ = false;
+        params.ponder = false;
+        stopFlag_ = false;
+    }
+
+    sendInfo(res, simulations, elapsedMs);
+    const std::vector<Move> pv = tree_.PrincipalVariation(2);
+    const int best = SelectBestMoveIndex(res, whiteToMove);
+    if (best < 0) {
+        send("bestmove 0000");
+        return;
+    }
+    const Move bestMove = res.visits[static_cast<std::size_t>(best)].first;
+    std::string line = "bestmove " + MoveToUci(bestMove);
+    if (pv.size() == 2 && MoveToUci(pv[0]) == MoveToUci(bestMove)) line += " ponder " + MoveToUci(pv[1]);
+    send(line);
+}
+
+void UCIEngine::sendInfo(const MCTSResult& res, int simulations, double elapsedMs) {
+    const bool whiteToMove = tree_.RootBoard().GetWhiteToMove();
+    const int best = SelectBestMoveIndex(res, whiteToMove);
+    std::string score;
+    if (res.provenResult == GameResult::Draw) {
+        score = "cp 0";
+    } else if (res.provenResult != GameResult::Ongoing) {
+        // mate N は N 手（自分の手数）で詰ます・詰まされる。手数が不明なら詰みとは書かず大きな cp にする
+        const bool win = (res.provenResult == GameResult::WhiteWin) == whiteToMove;
+        if (res.provenPlies >= 0)
+            score = "mate " + std::to_string(win ? (res.provenPlies + 1) / 2 : -((res.provenPlies + 1) / 2));
+        else
+            score = "cp " + std::to_string(win ? PROVEN_CENTIPAWNS : -PROVEN_CENTIPAWNS);
+    } else if (best >= 0) {
+        score = "cp " + std::to_string(valueToCentipawns(tree_.MoveValue(res.visits[static_cast<std::size_t>(best)].first)));
+    } else {
+        score = "cp 0";
+    }
+    const std::vector<Move> pv = tree_.PrincipalVariation(32);
+    std::string line = "info depth " + std::to_string(std::max<std::size_t>(1, pv.size())) +
+                       " nodes " + std::to_string(tree_.RootVisits()) +
+                       " nps " + std::to_string(elapsedMs > 0.0 ? static_cast<long>(simulations * 1000.0 / elapsedMs) : 0L) +
+                       " time " + std::to_string(static_cast<long>(elapsedMs)) + " score " + score;
+    if (!pv.empty()) {
+        line += " pv";
+        for (const Move& m : pv) line += " " + MoveToUci(m);
+    }
+    send(line);
+}
@@ -0,0 +1,8 @@
+#include "uci.hpp"
+#include <iostream>
+
+int main() {
+    UCIEngine engine(std::cin, std::cout);
+    engine.Run();
+    return 0;
+}
@@ -5,18 +5,18 @@ U64 Zobrist::table[64][12] = {{0}};
 U64 Zobrist::sideKey = 0;
 U64 Zobrist::castlingKeys[4] = {0};
 U64 Zobrist::epKeys[16] = {0};
-bool Zobrist::initialized = false;
+std::once_flag Zobrist::initFlag;
 
 void Zobrist::Init() {
-    if (initialized) return;
-    std::mt19937_64 gen(12345);
-    for (int sq = 0; sq < 64; sq++)
-        for (int i = 0; i < 12; i++)
-            table[sq][i] = gen();
-    sideKey = gen();
-    for (int i = 0; i < 4; i++) castlingKeys[i] = gen();
-    for (int i = 0; i < 16; i++) epKeys[i] = gen();
-    initialized = true;
+    std::call_once(initFlag, []() {
+        std::mt19937_64 gen(12345);
+        for (int sq = 0; sq < 64; sq++)
+            for (int i = 0; i < 12; i++)
+                table[sq][i] = gen();
+        sideKey = gen();
+        for (int i = 0; i < 4; i++) castlingKeys[i] = gen();
+        for (int i = 0; i < 16; i++) epKeys[i] = gen();
+    });
 }
 
 U64 Zobrist::GetPieceKey(Square sq, int pieceType, bool isWhite) {
@@ -0,0 +1,144 @@
+// Bitbases: 既知の KPK / KRK 局面の結果、1 手先の最善の結果との一致、.bb ファイルの保存と読み込みを確認する
+#include "bitbase.hpp"
+#include "board.hpp"
+#include "move.hpp"
+#include "movegen.hpp"
+#include <cstdio>
+#include <iostream>
+#include <random>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+static int failures = 0;
+
+static void check(bool ok, const std::string& what) {
+    if (!ok) {
+        std::cerr << "FAIL: " << what << std::endl;
+        failures++;
+    }
+}
+
+static const char* resultName(GameResult r) {
+    switch (r) {
+        case GameResult::WhiteWin: return "1-0";
+        case GameResult::BlackWin: return "0-1";
+        case GameResult::Draw: return "1/2";
+        default: return "ongoing";
+    }
+}
+
+/// 表の値が、合法手で 1 手進めた局面の値のうち手番側に最善のものと一致するか
+static bool consistent(const Bitbases& bb, Board& board) {
+    const GameResult r = bb.Probe(board);
+    std::vector<Move> moves;
+    MoveGen::GenerateLegalMoves(board, moves);
+    if (moves.empty()) return r == MoveGen::GetGameResult(board);
+    const bool white = board.GetWhiteToMove();
+    const GameResult win = white ? GameResult::WhiteWin : GameResult::BlackWin;
+    GameResult best = white ? GameResult::BlackWin : GameResult::WhiteWin;
+    for (const Move& m : moves) {
+        Board child = board;
+        child.MakeMove(m);
+        const GameResult c = bb.Probe(child);
+        if (c == GameResult::Ongoing) return false;
+        if (c == win) {
+            best = win;
+            break;
+        }
+        if (c == GameResult::Draw) best = GameResult::Draw;
+    }
+    return r == best;
+}
+
+/// 駒種 types・色 white の駒を乱数で並べる。マスが重なる・ポーンが端の段にある・手番でない側が王手されているなら false
+static bool randomPosition(const std::vector<int>& types, const std::vector<bool>& white, std::mt19937& gen, Board& board) {
+    std::uniform_int_distribution<int> square(0, 63);
+    std::vector<Square> sqs;
+    U64 occ = 0;
+    for (std::size_t i = 0; i < types.size(); i++) {
+        const int sq = square(gen);
+        if ((occ >> sq) & 1ULL) return false;
+        if (types[i] == PAWN && ((sq >> 3) == 0 || (sq >> 3) == 7)) return false;
+        occ |= 1ULL << sq;
+        sqs.push_back(static_cast<Square>(sq));
+    }
+    const bool whiteToMove = (gen() & 1) != 0;
+    bool colors[BITBASE_MAX_PIECES];
+    for (std::size_t i = 0; i < white.size(); i++) colors[i] = white[i];
+    board.SetPieces(types.data(), sqs.data(), colors, static_cast<int>(types.size()), whiteToMove);
+    return !board.IsInCheck(!whiteToMove);
+}
+
+int main() {
+    MoveGen::Init();
+    Bitbases bb;
+    bb.Generate("KPK");
+    bb.Generate("KRK");
+
+    struct Known {
+        const char* fen;
+        GameResult result;
+    };
+    const std::vector<Known> known = {
+        {"4k3/8/4K3/4P3/8/8/8/8 w - - 0 1", GameResult::WhiteWin},  // キングがポーンの 2 つ前にいれば勝ち
+        {"4k3/8/4K3/4P3/8/8/8/8 b - - 0 1", GameResult::WhiteWin},
+        {"4k3/4P3/4K3/8/8/8/8/8 b - - 0 1", GameResult::Draw},      // ステイルメイト
+        {"k7/8/K7/P7/8/8/8/8 w - - 0 1", GameResult::Draw},         // 隅に入られた a ポーン
+        {"8/8/8/8/4p3/4k3/8/4K3 b - - 0 1", GameResult::BlackWin},  // 黒が強い側でも引ける
+        {"8/8/8/4k3/8/8/8/R3K3 b - - 0 1", GameResult::WhiteWin},
+        {"8/8/8/8/8/8/1k6/R2K4 b - - 0 1", GameResult::Draw},       // ルークをただで取れる
+        {"R5k1/8/6K1/8/8/8/8/8 b - - 0 1", GameResult::WhiteWin},   // チェックメイト
+        {"8/8/8/8/8/8/8/k1K5 w - - 0 1", GameResult::Draw},         // キングだけ
+    };
+    for (const Known& k : known) {
+        Board board;
+        board.SetFromFen(k.fen);
+        const GameResult r = bb.Probe(board);
+        check(r == k.result, std::string(k.fen) + ": got " + resultName(r) + ", expected " + resultName(k.result));
+    }
+
+    // 無作為な局面で、表の値が 1 手先の最善の値と一致するか（KQK / KRK は KPK の昇格先として作られる）
+    std::mt19937 gen(12345);
+    const std::vector<std::pair<std::vector<int>, std::vector<bool>>> materials = {
+        {{KING, PAWN, KING}, {true, true, false}},
+        {{KING, ROOK, KING}, {true, true, false}},
+        {{KING, QUEEN, KING}, {true, true, false}},
+    };
+    std::vector<Board> samples;
+    for (const auto& mat : materials) {
+        int tested = 0, mismatches = 0;
+        while (tested < 3000) {
+            Board board;
+            if (!randomPosition(mat.first, mat.second, gen, board)) continue;
+            tested++;
+            if (!consistent(bb, board)) {
+                if (mismatches++ < 5) check(false, "inconsistent with one move later: " + board.GetFen());
+            }
+            if (mat.first[1] == PAWN) samples.push_back(board);
+        }
+        check(mismatches == 0, std::to_string(mismatches) + " inconsistent positions");
+    }
+
+    // .bb に保存して別のインスタンスで mmap し、同じ値を引けるか
+    const std::string path = "/tmp/test_bitbase_" + std::to_string(::getpid()) + ".bb";
+    bb.Save("KPK", path);
+    {
+        Bitbases loaded;
+        loaded.Load(path);
+        check(loaded.Materials() == std::vector<std::string>{"KPK"}, "loaded materials");
+        for (const Board& b : samples)
+            if (loaded.Probe(b) != bb.Probe(b)) {
+                check(false, "loaded table differs at " + b.GetFen());
+                break;
+            }
+    }
+    std::remove(path.c_str());
+
+    if (failures > 0) {
+        std::cerr << failures << " check(s) failed" << std::endl;
+        return 1;
+    }
+    std::cout << "test_bitbase: ok" << std::endl;
+    return 0;
+}
@@ -0,0 +1,60 @@
+// MoveGen::StaticExchangeEval: X 線で後ろから加わる飛び駒・アンパッサン・取らない手の値を確認する
+#include "board.hpp"
+#include "move.hpp"
+#include "movegen.hpp"
+#include <iostream>
+#include <string>
+#include <vector>
+
+static int failures = 0;
+
+static void check(bool ok, const std::string& what) {
+    if (!ok) {
+        std::cerr << "FAIL: " << what << std::endl;
+        failures++;
+    }
+}
+
+int main() {
+    MoveGen::Init();
+    struct Case {
+        const char* fen;
+        const char* uci;
+        int expected;
+    };
+    const std::vector<Case> cases = {
+        // 取り返すルークの後ろに並んだルーク・クイーン（X 線）まで数える
+        {"3rk3/3r4/8/3p4/8/8/3R4/3QK3 w - - 0 1", "d2d5", -400},
+        {"1k1r3q/1ppn3p/p4b2/4p3/8/P2N2P1/1PP1R1BP/2K1Q3 w - - 0 1", "d3e5", -220},
+        {"4k3/8/8/3r4/8/8/3R4/3QK3 w - - 0 1", "d2d5", 500},
+        {"3qk3/3r4/8/3r4/8/8/3R4/3QK3 w - - 0 1", "d2d5", 0},
+        // アンパッサン: 取られるポーンは to の後ろにいて、c7 のポーンが取り返す
+        {"4k3/2p5/8/3pP3/8/8/8/4K3 w - d6 0 1", "e5d6", 0},
+        {"4k3/8/8/3pP3/8/8/8/4K3 w - d6 0 1", "e5d6", 100},
+        // 取らない手は、動かした駒がただで取られるなら負
+        {"4k3/8/8/8/2p5/8/3N4/4K3 w - - 0 1", "d2b3", -320},
+        {"4k3/8/8/8/8/8/3N4/4K3 w - - 0 1", "d2b3", 0},
+    };
+    for (const Case& c : cases) {
+        Board board;
+        board.SetFromFen(c.fen);
+        std::vector<Move> moves;
+        MoveGen::GenerateLegalMoves(board, moves);
+        bool found = false;
+        for (const Move& m : moves) {
+            if (MoveToUci(m) != c.uci) continue;
+            found = true;
+            const int see = MoveGen::StaticExchangeEval(board, m);
+            check(see == c.expected, std::string(c.fen) + " " + c.uci + ": got " + std::to_string(see) + ", expected " +
+                                         std::to_string(c.expected));
+        }
+        check(found, std::string(c.fen) + ": no legal move " + c.uci);
+    }
+
+    if (failures > 0) {
+        std::cerr << failures << " check(s) failed" << std::endl;
+        return 1;
+    }
+    std::cout << "test_see: ok" << std::endl;
+    return 0;
+}
@@ -0,0 +1,124 @@
+// TrainingDataWriter で書いたレコードを TrainingDataReader で読み戻し、局面・方策・値・結果が一致するか、書き込みの失敗が例外になるか確認する
+#include "board.hpp"
+#include "encoding.hpp"
+#include "move.hpp"
+#include "movegen.hpp"
+#include "training_data.hpp"
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+static int failures = 0;
+
+static void check(bool ok, const std::string& what) {
+    if (!ok) {
+        std::cerr << "FAIL: " << what << std::endl;
+        failures++;
+    }
+}
+
+/// path が /proc/self/maps に残っていれば true（mmap の解放漏れ）
+static bool isMapped(const std::string& path) {
+    std::ifstream maps("/proc/self/maps");
+    std::string line;
+    while (std::getline(maps, line))
+        if (line.find(path) != std::string::npos) return true;
+    return false;
+}
+
+int main() {
+    MoveGen::Init();
+    const std::string path = "/tmp/test_training_data_" + std::to_string(::getpid()) + ".bctr";
+    const std::string badPath = path + ".bad";
+    std::remove(path.c_str());
+
+    // 手番・キャスリング権・アンパッサン・50 手カウンタがすべて入った局面を使う
+    const std::vector<std::string> fens = {
+        "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+        "r3k2r/pp3ppp/8/3pP3/8/8/PP3PPP/R3K2R w Kq d6 0 1",
+        "8/8/4k3/8/8/3K4/6p1/8 b - - 37 1",
+    };
+    std::vector<TrainingRecord> records;
+    for (std::size_t i = 0; i < fens.size(); i++) {
+        Board board;
+        board.SetFromFen(fens[i]);
+        std::vector<Move> moves;
+        MoveGen::GenerateLegalMoves(board, moves);
+        TrainingRecord rec;
+        rec.position = PackPosition(board);
+        rec.result = static_cast<int8_t>(static_cast<int>(i) - 1);
+        rec.rootValue = 0.25f * static_cast<float>(i) - 0.4f;
+        for (std::size_t j = 0; j < moves.size() && j < 3; j++)
+            rec.policy.push_back({static_cast<uint16_t>(MoveToPolicyIndex(moves[j])), static_cast<uint16_t>(j + 1)});
+        records.push_back(rec);
+    }
+    {
+        TrainingDataWriter writer(path);
+        writer.Write(records);
+        writer.Close();
+    }
+
+    {
+        TrainingDataReader reader({path}, 1);
+        check(reader.Size() == records.size(), "record count");
+        std::vector<float> planes(INPUT_SIZE), policy(POLICY_SIZE);
+        for (std::size_t i = 0; i < reader.Size() && i < records.size(); i++) {
+            const TrainingRecord rec = reader.Record(i);
+            check(PackedPositionToFen(rec.position) == fens[i], "fen of record " + std::to_string(i) + ": " +
+                                                                   PackedPositionToFen(rec.position));
+            check(rec.result == records[i].result, "result of record " + std::to_string(i));
+            check(rec.rootValue == records[i].rootValue, "root value of record " + std::to_string(i));
+            check(rec.policy == records[i].policy, "policy of record " + std::to_string(i));
+
+            // Fill は訪問数を合計 1 に正規化し、value に result を入れる
+            float value = 0.0f, rootValue = 0.0f;
+            reader.Fill(&i, 1, planes.data(), policy.data(), &value, &rootValue);
+            double total = 0.0;
+            for (const auto& p : records[i].policy) total += p.second;
+            for (const auto& p : records[i].policy)
+                check(std::fabs(policy[p.first] - p.second / total) < 1e-6, "normalized policy of record " + std::to_string(i));
+            check(value == static_cast<float>(records[i].result), "value of record " + std::to_string(i));
+            check(rootValue == records[i].rootValue, "filled root value of record " + std::to_string(i));
+        }
+    }
+
+    // ヘッダの違うファイルは例外になり、先に開いた正しいファイルの mmap も残らない
+    {
+        std::ofstream bad(badPath, std::ios::binary | std::ios::trunc);
+        bad << "not a training data file";
+    }
+    bool threw = false;
+    try {
+        TrainingDataReader reader({path, badPath}, 1);
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+    check(threw, "bad header throws");
+    check(!isMapped(path) && !isMapped(badPath), "mappings released after a failed open");
+
+    // 書き込みに失敗したら（/dev/full は常に ENOSPC）Close が例外で知らせ、書けなかったレコードは数えない
+    threw = false;
+    TrainingDataWriter full("/dev/full");
+    full.Write(records);
+    try {
+        full.Close();
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+    check(threw, "write failure surfaces from Close");
+    check(full.RecordsWritten() == 0, "records written after a failed write: " + std::to_string(full.RecordsWritten()));
+
+    std::remove(path.c_str());
+    std::remove(badPath.c_str());
+    if (failures > 0) {
+        std::cerr << failures << " check(s) failed" << std::endl;
+        return 1;
+    }
+    std::cout << "test_training_data: ok" << std::endl;
+    return 0;
+}